@@ -0,0 +1,281 @@
+//  ---------------------------------------------------------------------------
+//  This file is part of reSID, a MOS6581 SID emulator engine.
+//  Copyright (C) 2010  Dag Lem <resid@nimrod.no>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//  ---------------------------------------------------------------------------
+
+// Benchmark suite for libresid, built and run by "make bench".
+//
+// A SID is driven through representative register scripts for each
+// combination of chip model and sampling method, reporting emulated
+// cycles per wallclock second. The scripts are deterministic, and a
+// checksum over all rendered samples is reported so that runs on
+// different revisions can be compared for output divergence as well as
+// for speed.
+//
+// The per subsystem breakdown at the end is derived by differencing
+// configurations (filter and external filter disabled/enabled, fast
+// sampling versus resampling), since the emulator itself contains no
+// instrumentation.
+
+#include "sid.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace reSID;
+
+const double CLOCK_PAL = 985248;
+const double SAMPLE_FREQ = 48000;
+const cycle_count CYCLES_PER_FRAME = 19656;
+
+// Emulated seconds per benchmark run; can be overridden on the command
+// line for quicker runs or more stable numbers.
+static double emulated_seconds = 2.0;
+
+// Checksum over all rendered samples (FNV-1a).
+static unsigned long long checksum = 1469598103934665603ULL;
+
+static void checksum_mix(const short* buf, int n)
+{
+  for (int i = 0; i < n; i++) {
+    checksum ^= (unsigned short)buf[i];
+    checksum *= 1099511628211ULL;
+  }
+}
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+
+// ----------------------------------------------------------------------------
+// Register scripts. Each script writes the registers for one frame.
+// ----------------------------------------------------------------------------
+
+// Silence - reset state, volume up, no gates. The baseline cost of
+// clocking the chip with all envelopes idle.
+static void script_silence(SID& sid, int frame)
+{
+  if (frame == 0) {
+    sid.write(0x18, 0x0f);
+  }
+}
+
+// Three voice chip tune - arpeggio lead, pulse width swept bass, noise
+// percussion with frequent gate toggles, bass routed through the filter.
+static void script_chiptune(SID& sid, int frame)
+{
+  static const reg16 arp[4] = { 0x1cd6, 0x2442, 0x2af5, 0x39ac };
+
+  if (frame == 0) {
+    sid.write(0x05, 0x0a); sid.write(0x06, 0x89);
+    sid.write(0x0c, 0x49); sid.write(0x0d, 0x99);
+    sid.write(0x13, 0x02); sid.write(0x14, 0xa8);
+    sid.write(0x16, 0x50); sid.write(0x17, 0xf2);
+    sid.write(0x18, 0x1f);
+  }
+
+  // Lead: triangle arpeggio.
+  reg16 freq = arp[frame % 4];
+  sid.write(0x00, freq & 0xff);
+  sid.write(0x01, freq >> 8);
+  sid.write(0x04, (frame % 24 < 21) ? 0x11 : 0x10);
+
+  // Bass: pulse with swept pulse width.
+  if (frame % 12 == 0) {
+    sid.write(0x07, 0x6b);
+    sid.write(0x08, (frame % 24) ? 0x07 : 0x05);
+  }
+  reg16 pw = 0x400 + ((frame*0x23) & 0x3ff);
+  sid.write(0x09, pw & 0xff);
+  sid.write(0x0a, pw >> 8);
+  sid.write(0x0b, (frame % 12 < 10) ? 0x41 : 0x40);
+
+  // Percussion: gated noise every 6 frames.
+  if (frame % 6 == 0) {
+    sid.write(0x0e, 0xd0); sid.write(0x0f, 0x1c);
+  }
+  sid.write(0x12, (frame % 6 < 2) ? 0x81 : 0x80);
+}
+
+// Combined waveforms with filter sweeps - the worst case for the wave
+// and filter stages: all voices use combined waveforms and are routed
+// through the filter, with the cutoff swept every frame.
+static void script_sweep(SID& sid, int frame)
+{
+  if (frame == 0) {
+    sid.write(0x00, 0xd6); sid.write(0x01, 0x1c);
+    sid.write(0x07, 0x42); sid.write(0x08, 0x24);
+    sid.write(0x0e, 0xac); sid.write(0x0f, 0x39);
+    sid.write(0x05, 0x29); sid.write(0x06, 0xa9);
+    sid.write(0x0c, 0x29); sid.write(0x0d, 0xa9);
+    sid.write(0x13, 0x29); sid.write(0x14, 0xa9);
+    sid.write(0x04, 0x51);
+    sid.write(0x0b, 0x61);
+    sid.write(0x12, 0x71);
+    sid.write(0x18, 0x1f);
+  }
+
+  // Sweep the cutoff up and down, change resonance now and then.
+  int sweep = frame % 512;
+  reg8 fc_hi = sweep < 256 ? sweep : 511 - sweep;
+  sid.write(0x15, (frame*3) & 0x07);
+  sid.write(0x16, fc_hi);
+  if (frame % 128 == 0) {
+    sid.write(0x17, ((frame >> 3) & 0xf0) | 0x07);
+  }
+}
+
+typedef void (*script_t)(SID&, int);
+
+struct scenario
+{
+  const char* name;
+  script_t script;
+};
+
+static const scenario scenarios[] = {
+  { "silence",  script_silence },
+  { "chiptune", script_chiptune },
+  { "sweep",    script_sweep }
+};
+
+struct method
+{
+  const char* name;
+  sampling_method sampling;
+};
+
+static const method methods[] = {
+  { "fast",     SAMPLE_FAST },
+  { "interp",   SAMPLE_INTERPOLATE },
+  { "resample", SAMPLE_RESAMPLE },
+  { "fastmem",  SAMPLE_RESAMPLE_FASTMEM },
+  { "twostage", SAMPLE_RESAMPLE_TWOSTAGE }
+};
+
+
+// ----------------------------------------------------------------------------
+// Run one script for the configured emulated time, returning the
+// wallclock seconds spent.
+// ----------------------------------------------------------------------------
+static double run(SID& sid, script_t script)
+{
+  short buf[4096];
+  long frames = long(emulated_seconds*CLOCK_PAL/CYCLES_PER_FRAME);
+
+  double t0 = now();
+  for (int frame = 0; frame < frames; frame++) {
+    script(sid, frame);
+    cycle_count delta_t = CYCLES_PER_FRAME;
+    while (delta_t) {
+      int n = sid.clock(delta_t, buf, 4096);
+      checksum_mix(buf, n);
+    }
+  }
+  return now() - t0;
+}
+
+static double bench_cycles_per_second(chip_model model, sampling_method sampling,
+                                      script_t script,
+                                      bool filter = true, bool extfilt = true)
+{
+  SID sid;
+  sid.set_chip_model(model);
+  sid.enable_filter(filter);
+  sid.enable_external_filter(extfilt);
+  if (!sid.set_sampling_parameters(CLOCK_PAL, sampling, SAMPLE_FREQ)) {
+    fprintf(stderr, "set_sampling_parameters failed\n");
+    exit(1);
+  }
+  sid.reset();
+
+  return emulated_seconds*CLOCK_PAL/run(sid, script);
+}
+
+
+int main(int argc, char** argv)
+{
+  if (argc > 1) {
+    emulated_seconds = atof(argv[1]);
+    if (emulated_seconds <= 0) {
+      fprintf(stderr, "usage: %s [emulated seconds per run]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  static const chip_model models[2] = { MOS6581, MOS8580 };
+  static const char* model_names[2] = { "6581", "8580" };
+
+  printf("reSID benchmark - %.1f emulated seconds per run, %.0fHz output\n\n",
+         emulated_seconds, SAMPLE_FREQ);
+  printf("Emulated cycles per wallclock second (millions):\n\n");
+
+  printf("%-10s", "scenario");
+  for (unsigned int m = 0; m < sizeof(methods)/sizeof(methods[0]); m++) {
+    printf("  %8s", methods[m].name);
+  }
+  printf("\n");
+
+  for (int c = 0; c < 2; c++) {
+    for (unsigned int s = 0; s < sizeof(scenarios)/sizeof(scenarios[0]); s++) {
+      printf("%-10s", scenarios[s].name);
+      for (unsigned int m = 0; m < sizeof(methods)/sizeof(methods[0]); m++) {
+        double cps = bench_cycles_per_second(models[c], methods[m].sampling,
+                                             scenarios[s].script);
+        printf("  %8.1f", cps/1e6);
+        fflush(stdout);
+      }
+      printf("  (%s)\n", model_names[c]);
+    }
+  }
+
+  // Per subsystem breakdown, derived by differencing configurations on
+  // the sweep scenario: voices = oscillators and envelopes only, filter
+  // and extfilt are the added cost of enabling each stage, cycle is the
+  // added cost of cycle-exact clocking (SAMPLE_INTERPOLATE versus the
+  // batched SAMPLE_FAST paths), and fir is the added resampling
+  // convolution cost on top of that.
+  printf("\nDerived per subsystem breakdown, sweep scenario (ns/cycle):\n\n");
+  printf("%-10s  %7s  %7s  %7s  %7s  %7s\n",
+         "", "voices", "filter", "extfilt", "cycle", "fir");
+
+  for (int c = 0; c < 2; c++) {
+    double t_voices = 1e9/bench_cycles_per_second(
+      models[c], SAMPLE_FAST, script_sweep, false, false);
+    double t_filter = 1e9/bench_cycles_per_second(
+      models[c], SAMPLE_FAST, script_sweep, true, false);
+    double t_extfilt = 1e9/bench_cycles_per_second(
+      models[c], SAMPLE_FAST, script_sweep, true, true);
+    double t_cycle = 1e9/bench_cycles_per_second(
+      models[c], SAMPLE_INTERPOLATE, script_sweep, true, true);
+    double t_fir = 1e9/bench_cycles_per_second(
+      models[c], SAMPLE_RESAMPLE, script_sweep, true, true);
+
+    printf("%-10s  %7.2f  %7.2f  %7.2f  %7.2f  %7.2f\n", model_names[c],
+           t_voices, t_filter - t_voices, t_extfilt - t_filter,
+           t_cycle - t_extfilt, t_fir - t_cycle);
+  }
+
+  printf("\nchecksum=%016llx\n", checksum);
+
+  return 0;
+}
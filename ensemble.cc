@@ -0,0 +1,263 @@
+//  ---------------------------------------------------------------------------
+//  This file is part of reSID, a MOS6581 SID emulator engine.
+//  Copyright (C) 2010  Dag Lem <resid@nimrod.no>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//  ---------------------------------------------------------------------------
+
+#include "ensemble.h"
+
+#include <thread>
+
+namespace reSID
+{
+
+// Cycles clocked per chip before moving on to the next chip. Long enough
+// to amortize reloading the per-chip state, short enough that the shared
+// filter and FIR tables stay cache resident across the chips.
+enum { SLICE_CYCLES = 4096 };
+
+// Ensembles below this size are always clocked serially; the threading
+// overhead outweighs the gain for a chip or two per audio fragment.
+enum { MIN_CHIPS_THREADED = 4 };
+
+
+// ----------------------------------------------------------------------------
+// Constructor.
+// ----------------------------------------------------------------------------
+SIDEnsemble::SIDEnsemble()
+{
+  n_chips = 1;
+  max_threads = 1;
+  mix_buf = 0;
+  mix_buf_size = 0;
+}
+
+SIDEnsemble::~SIDEnsemble()
+{
+  delete[] mix_buf;
+}
+
+
+// ----------------------------------------------------------------------------
+// Ensemble configuration.
+// ----------------------------------------------------------------------------
+bool SIDEnsemble::set_chip_count(int n)
+{
+  if (n < 1 || n > MAX_CHIPS) {
+    return false;
+  }
+  n_chips = n;
+  return true;
+}
+
+int SIDEnsemble::chip_count() const
+{
+  return n_chips;
+}
+
+SID& SIDEnsemble::sid(int chip)
+{
+  return this->chip[chip];
+}
+
+bool SIDEnsemble::set_sampling_parameters(double clock_freq,
+                                          sampling_method method,
+                                          double sample_freq)
+{
+  for (int i = 0; i < MAX_CHIPS; i++) {
+    if (!chip[i].set_sampling_parameters(clock_freq, method, sample_freq)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SIDEnsemble::reset()
+{
+  for (int i = 0; i < MAX_CHIPS; i++) {
+    chip[i].reset();
+  }
+}
+
+void SIDEnsemble::write(int chip, reg8 offset, reg8 value)
+{
+  this->chip[chip].write(offset, value);
+}
+
+bool SIDEnsemble::queue_write(int chip, cycle_count delay, reg8 offset,
+                              reg8 value)
+{
+  return this->chip[chip].queue_write(delay, offset, value);
+}
+
+void SIDEnsemble::set_max_threads(int threads)
+{
+  if (threads <= 0) {
+    threads = std::thread::hardware_concurrency();
+    if (threads <= 0) {
+      threads = 1;
+    }
+  }
+  max_threads = threads;
+}
+
+
+// ----------------------------------------------------------------------------
+// Serial clocking - interleave short time slices across the chips.
+//
+// Since all chips share sampling parameters and are clocked by the same
+// cycle counts, they produce identical sample counts per slice, keeping
+// the interleaved output aligned.
+// ----------------------------------------------------------------------------
+int SIDEnsemble::clock_serial(cycle_count& delta_t, short* buf, int n)
+{
+  int s = 0;
+
+  while (delta_t && s < n) {
+    cycle_count slice = delta_t < SLICE_CYCLES ? delta_t : SLICE_CYCLES;
+    cycle_count slice_left = slice;
+    int slice_samples = 0;
+
+    for (int i = 0; i < n_chips; i++) {
+      cycle_count dt = slice;
+      slice_samples =
+        chip[i].clock(dt, buf + s*n_chips + i, n - s, n_chips);
+      slice_left = dt;
+    }
+
+    s += slice_samples;
+    delta_t -= slice - slice_left;
+  }
+
+  return s;
+}
+
+
+// ----------------------------------------------------------------------------
+// Threaded clocking - each worker clocks a subset of the chips over the
+// full time interval, writing directly into its interleaved positions in
+// the output buffer.
+// ----------------------------------------------------------------------------
+struct ensemble_job
+{
+  SID* chips;
+  int chip_start;
+  int chip_end;
+  int n_chips;
+  cycle_count delta_t;
+  cycle_count delta_t_left;
+  short* buf;
+  int n;
+  int produced;
+};
+
+static void ensemble_job_run(ensemble_job* job)
+{
+  job->delta_t_left = job->delta_t;
+  for (int i = job->chip_start; i < job->chip_end; i++) {
+    cycle_count dt = job->delta_t;
+    job->produced = job->chips[i].clock(dt, job->buf + i, job->n,
+                                        job->n_chips);
+    // All chips consume the same number of cycles for a given sample
+    // count, since they share sampling parameters.
+    job->delta_t_left = dt;
+  }
+}
+
+int SIDEnsemble::clock_threaded(cycle_count& delta_t, short* buf, int n)
+{
+  int threads = max_threads < n_chips ? max_threads : n_chips;
+
+  ensemble_job* jobs = new ensemble_job[threads];
+  std::thread* workers = new std::thread[threads];
+
+  int chips_per_job = n_chips/threads;
+  int chips_extra = n_chips % threads;
+  int chip_start = 0;
+
+  for (int i = 0; i < threads; i++) {
+    ensemble_job& job = jobs[i];
+    job.chips = chip;
+    job.chip_start = chip_start;
+    chip_start += chips_per_job + (i < chips_extra ? 1 : 0);
+    job.chip_end = chip_start;
+    job.n_chips = n_chips;
+    job.delta_t = delta_t;
+    job.delta_t_left = delta_t;
+    job.buf = buf;
+    job.n = n;
+    job.produced = 0;
+
+    workers[i] = std::thread(ensemble_job_run, &job);
+  }
+
+  int s = 0;
+  for (int i = 0; i < threads; i++) {
+    workers[i].join();
+    s = jobs[i].produced;
+    delta_t = jobs[i].delta_t_left;
+  }
+
+  delete[] workers;
+  delete[] jobs;
+
+  return s;
+}
+
+
+// ----------------------------------------------------------------------------
+// Clock all chips, interleaved output.
+// ----------------------------------------------------------------------------
+int SIDEnsemble::clock(cycle_count& delta_t, short* buf, int n)
+{
+  if (max_threads > 1 && n_chips >= MIN_CHIPS_THREADED) {
+    return clock_threaded(delta_t, buf, n);
+  }
+  return clock_serial(delta_t, buf, n);
+}
+
+
+// ----------------------------------------------------------------------------
+// Clock all chips, mixed single channel output.
+// ----------------------------------------------------------------------------
+int SIDEnsemble::clock_mixed(cycle_count& delta_t, short* buf, int n)
+{
+  if (n*n_chips > mix_buf_size) {
+    delete[] mix_buf;
+    mix_buf_size = n*n_chips;
+    mix_buf = new short[mix_buf_size];
+  }
+
+  int s = clock(delta_t, mix_buf, n);
+
+  for (int i = 0; i < s; i++) {
+    int v = 0;
+    for (int c = 0; c < n_chips; c++) {
+      v += mix_buf[i*n_chips + c];
+    }
+    if (v >= 32768) {
+      v = 32767;
+    }
+    else if (v < -32768) {
+      v = -32768;
+    }
+    buf[i] = v;
+  }
+
+  return s;
+}
+
+} // namespace reSID
@@ -0,0 +1,99 @@
+//  ---------------------------------------------------------------------------
+//  This file is part of reSID, a MOS6581 SID emulator engine.
+//  Copyright (C) 2010  Dag Lem <resid@nimrod.no>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//  ---------------------------------------------------------------------------
+
+#ifndef RESID_ENSEMBLE_H
+#define RESID_ENSEMBLE_H
+
+#include "resid-config.h"
+#include "sid.h"
+
+namespace reSID
+{
+
+// ----------------------------------------------------------------------------
+// Ensemble of SID chips clocked in one pass, for 2SID/3SID machines and
+// multi-chip installations.
+//
+// Clocking each SID instance independently over a full audio fragment
+// evicts the shared filter and FIR tables from the CPU caches between
+// instances. SIDEnsemble instead advances all chips in lockstep over
+// short time slices, so the tables stay cache resident across chips,
+// and optionally fans the chips out over threads for larger ensembles.
+//
+// All chips share one set of sampling parameters, set via the ensemble;
+// this guarantees that the chips produce the same number of samples for
+// a given number of cycles, allowing the per-chip outputs to be
+// interleaved sample by sample in a single buffer. Chip models, filter
+// settings and register writes are per chip, via sid(chip) or the
+// write/queue_write convenience wrappers.
+// ----------------------------------------------------------------------------
+class SIDEnsemble
+{
+public:
+  enum { MAX_CHIPS = 8 };
+
+  SIDEnsemble();
+  ~SIDEnsemble();
+
+  // Number of chips in the ensemble, 1 - MAX_CHIPS.
+  bool set_chip_count(int n);
+  int chip_count() const;
+
+  // Direct access for per-chip configuration and register reads.
+  SID& sid(int chip);
+
+  // Applied to all chips.
+  bool set_sampling_parameters(double clock_freq, sampling_method method,
+  double sample_freq);
+  void reset();
+
+  // Per-chip register writes, see SID::write and SID::queue_write.
+  void write(int chip, reg8 offset, reg8 value);
+  bool queue_write(int chip, cycle_count delay, reg8 offset, reg8 value);
+
+  // Maximum number of worker threads for the clocking below (default 1,
+  // i.e. no threading; 0 selects the number of hardware threads).
+  // Threads are only used for ensembles of four chips or more.
+  void set_max_threads(int threads);
+
+  // Clock all chips, writing n samples per chip interleaved in buf
+  // (sample s of chip c at buf[s*chip_count() + c]). Returns the number
+  // of samples written per chip.
+  int clock(cycle_count& delta_t, short* buf, int n);
+
+  // As above, but the chips are mixed with saturation into a single
+  // channel of n samples.
+  int clock_mixed(cycle_count& delta_t, short* buf, int n);
+
+protected:
+  int clock_serial(cycle_count& delta_t, short* buf, int n);
+  int clock_threaded(cycle_count& delta_t, short* buf, int n);
+
+  SID chip[MAX_CHIPS];
+  int n_chips;
+  int max_threads;
+
+  // Scratch buffer for clock_mixed.
+  short* mix_buf;
+  int mix_buf_size;
+};
+
+} // namespace reSID
+
+#endif // not RESID_ENSEMBLE_H
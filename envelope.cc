@@ -20,7 +20,6 @@
 #define RESID_ENVELOPE_CC
 
 #include "envelope.h"
-#include "dac.h"
 
 namespace reSID
 {
@@ -146,10 +145,12 @@ reg8 EnvelopeGenerator::sustain_level[] = {
 };
 
 
-// DAC lookup tables.
-unsigned short EnvelopeGenerator::model_dac[2][1 << 8] = {
-  {0},
-  {0},
+// DAC lookup tables for 8-bit DACs, computed at compile time.
+// MOS 6581: 2R/R ~ 2.20, missing termination resistor.
+// MOS 8580: 2R/R ~ 2.00, correct termination.
+const dac_table<8> EnvelopeGenerator::model_dac[2] = {
+  dac_table<8>(2.20, false),
+  dac_table<8>(2.00, true)
 };
 
 
@@ -158,18 +159,6 @@ unsigned short EnvelopeGenerator::model_dac[2][1 << 8] = {
 // ----------------------------------------------------------------------------
 EnvelopeGenerator::EnvelopeGenerator()
 {
-  static bool class_init;
-
-  if (!class_init) {
-    // Build DAC lookup tables for 8-bit DACs.
-    // MOS 6581: 2R/R ~ 2.20, missing termination resistor.
-    build_dac_table(model_dac[0], 8, 2.20, false);
-    // MOS 8580: 2R/R ~ 2.00, correct termination.
-    build_dac_table(model_dac[1], 8, 2.00, true);
-
-    class_init = true;
-  }
-
   set_chip_model(MOS6581);
 
   // Counter's odd bits are high on powerup
@@ -275,4 +264,30 @@ reg8 EnvelopeGenerator::readENV()
   return env3;
 }
 
+// ----------------------------------------------------------------------------
+// Number of cycles until the next internally scheduled state change,
+// i.e. how far the envelope can be fast-forwarded without missing a
+// pipelined state change or an envelope step. See SID::next_event().
+// ----------------------------------------------------------------------------
+cycle_count EnvelopeGenerator::next_event()
+{
+  // Pipelined state changes and envelope counter steps resolve on the
+  // following cycle.
+  if (state_pipeline || envelope_pipeline || exponential_pipeline
+      || reset_rate_counter)
+  {
+    return 1;
+  }
+
+  // Cycles until the rate counter reaches the rate period, counting
+  // through the 15 bit wraparound of the ADSR delay bug when the period
+  // has been set below the current counter value.
+  // NB! This requires two's complement integer.
+  int rate_step = rate_period - rate_counter;
+  if (rate_step <= 0) {
+    rate_step += 0x7fff;
+  }
+  return rate_step;
+}
+
 } // namespace reSID
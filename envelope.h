@@ -21,6 +21,7 @@
 #define RESID_ENVELOPE_H
 
 #include "resid-config.h"
+#include "dac.h"
 
 namespace reSID
 {
@@ -52,6 +53,9 @@ public:
   void writeSUSTAIN_RELEASE(reg8);
   reg8 readENV();
 
+  // Cycles until the next internally scheduled state change.
+  cycle_count next_event();
+
   // 8-bit envelope output.
   short output();
 
@@ -93,8 +97,8 @@ protected:
   // The 16 selectable sustain levels.
   static reg8 sustain_level[];
 
-  // DAC lookup tables.
-  static unsigned short model_dac[2][1 << 8];
+  // DAC lookup tables, computed at compile time into read-only memory.
+  static const dac_table<8> model_dac[2];
 
 friend class SID;
 };
@@ -216,6 +220,52 @@ void EnvelopeGenerator::clock(cycle_count delta_t)
     state_pipeline = 0;
   }
 
+  // Batched advancement for steady states, where the envelope counter
+  // cannot change during delta_t: frozen at zero, or resting at the
+  // sustain level in DECAY_SUSTAIN. Only the rate counter and the
+  // exponential counter evolve, and both are periodic, so the end state
+  // is computed in closed form instead of iterating over the rate
+  // periods. Most voices in most tunes sit in one of these states most
+  // of the time.
+  // The guards exclude the sustain levels coinciding with an exponential
+  // counter period change (0x00 freezes the envelope, 0xff selects
+  // period 1), and a pending period change or an out of range
+  // exponential counter left behind by a period change; these rare cases
+  // take the generic loop below.
+  if (likely(((hold_zero && state != ATTACK)
+              || (state == DECAY_SUSTAIN
+                  && envelope_counter == sustain_level[sustain]
+                  && envelope_counter != 0
+                  && (envelope_counter != 0xff
+                      || exponential_counter_period == 1)))
+             && new_exponential_counter_period == 0
+             && exponential_counter < exponential_counter_period))
+  {
+    // Check for ADSR delay bug (see below); the rate counter may have to
+    // count an extra 0x7fff cycles before its first event.
+    // NB! This requires two's complement integer.
+    int rate_event = rate_period - rate_counter;
+    if (unlikely(rate_event <= 0)) {
+      rate_event += 0x7fff;
+    }
+
+    if (likely(delta_t < rate_event)) {
+      rate_counter += delta_t;
+      if (unlikely(rate_counter & 0x8000)) {
+        ++rate_counter &= 0x7fff;
+      }
+      return;
+    }
+
+    // The rate counter resets to zero at each event, counting rate_period
+    // cycles between subsequent events.
+    cycle_count n_events = 1 + (delta_t - rate_event)/rate_period;
+    rate_counter = (delta_t - rate_event) % rate_period;
+    exponential_counter =
+      (exponential_counter + n_events) % exponential_counter_period;
+    return;
+  }
+
   // Check for ADSR delay bug.
   // If the rate counter comparison value is set below the current value of the
   // rate counter, the counter will continue counting up until it wraps around
@@ -61,6 +61,8 @@ public:
 
   void clock(short Vi);
   void clock(cycle_count delta_t, short Vi);
+  // Clock with the enabled check hoisted out, see below.
+  void clock_enabled(short Vi);
   void reset();
 
   // Audio output (16 bits).
@@ -104,6 +106,17 @@ void ExternalFilter::clock(short Vi)
     return;
   }
 
+  clock_enabled(Vi);
+}
+
+// ----------------------------------------------------------------------------
+// SID clocking - 1 cycle, with the enabled check hoisted out. Used by the
+// specialized block clocking in SID, which checks the configuration once
+// per block instead of once per cycle.
+// ----------------------------------------------------------------------------
+RESID_INLINE
+void ExternalFilter::clock_enabled(short Vi)
+{
   // Calculate filter outputs.
   // Vlp = Vlp + w0lp*(Vi - Vlp)*delta_t;
   // Vhp = Vhp + w0hp*(Vlp - Vhp)*delta_t;
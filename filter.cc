@@ -28,10 +28,35 @@
 #include "dac.h"
 #include "spline.h"
 #include <math.h>
+#include <mutex>
 
 namespace reSID
 {
 
+#if defined(__amiga__) && defined(__mc68000__)
+#undef HAS_LOG1P
+#endif
+
+#ifndef HAS_LOG1P
+static double log1p(double x)
+{
+    return log(1 + x) - (((1 + x) - 1) - x) / (1 + x);
+}
+#endif
+
+#if RESID_PREBUILT_FILTER_TABLES
+// Fully initialized tables generated at build time by genfilttables,
+// residing in shared read-only data.
+#include "filter_tables.h"
+#else
+unsigned short Filter::vcr_kVg[1 << 16];
+unsigned short Filter::vcr_n_Ids_term[1 << 16];
+
+Filter::model_filter_t Filter::model_filter[2];
+#endif
+
+
+#if !RESID_PREBUILT_FILTER_TABLES
 // This is the SID 6581 op-amp voltage transfer function, measured on
 // CAP1B/CAP1A on a chip marked MOS 6581R4AR 0687 14.
 // All measured chips have op-amps with output voltages (and thus input
@@ -175,208 +200,204 @@ static model_filter_init_t model_filter_init[2] = {
     }
 };
 
-unsigned short Filter::vcr_kVg[1 << 16];
-unsigned short Filter::vcr_n_Ids_term[1 << 16];
-
-#if defined(__amiga__) && defined(__mc68000__)
-#undef HAS_LOG1P
-#endif
+// ----------------------------------------------------------------------------
+// Lazy one-time initialization of the static filter tables.
+//
+// The tables amount to several megabytes per chip model, and are only
+// materialized when a model is first selected, so that processes which
+// only ever emulate one model do not pay for the other. Initialization
+// is serialized with a mutex so that SID instances can be constructed
+// and reconfigured from worker threads.
+// ----------------------------------------------------------------------------
+static std::mutex materialize_mutex;
+static bool materialized[2];
 
-#ifndef HAS_LOG1P
-static double log1p(double x)
+void Filter::materialize_tables(int model)
 {
-    return log(1 + x) - (((1 + x) - 1) - x) / (1 + x);
-}
-#endif
+    std::lock_guard<std::mutex> lock(materialize_mutex);
 
-Filter::model_filter_t Filter::model_filter[2];
+    if (materialized[model]) {
+        return;
+    }
 
+    // Temporary table for op-amp transfer function.
+    unsigned int* voltages = new unsigned int[1 << 16];
+    opamp_t* opamp = new opamp_t[1 << 16];
 
-// ----------------------------------------------------------------------------
-// Constructor.
-// ----------------------------------------------------------------------------
-Filter::Filter()
-{
-    static bool class_init;
-
-    if (!class_init) {
-        // Temporary table for op-amp transfer function.
-        unsigned int* voltages = new unsigned int[1 << 16];
-        opamp_t* opamp = new opamp_t[1 << 16];
-
-        for (int m = 0; m < 2; m++) {
-            model_filter_init_t& fi = model_filter_init[m];
-            model_filter_t& mf = model_filter[m];
-
-            // Convert op-amp voltage transfer to 16 bit values.
-            double vmin = fi.opamp_voltage[0][0];
-            double opamp_max = fi.opamp_voltage[0][1];
-            double kVddt = fi.k*(fi.Vdd - fi.Vth);
-            double vmax = kVddt < opamp_max ? opamp_max : kVddt;
-            double denorm = vmax - vmin;
-            double norm = 1.0/denorm;
-
-            // Scaling and translation constants.
-            double N16 = norm*((1u << 16) - 1);
-            double N30 = norm*((1u << 30) - 1);
-            double N31 = norm*((1u << 31) - 1);
-            mf.vo_N16 = (int)(N16);  // FIXME: Remove?
-
-            // The "zero" output level of the voices.
-            // The digital range of one voice is 20 bits; create a scaling term
-            // for multiplication which fits in 11 bits.
-            double N14 = norm*(1u << 14);
-            mf.voice_scale_s14 = (int)(N14*fi.voice_voltage_range);
-            mf.voice_DC = (int)(N16*(fi.voice_DC_voltage - vmin));
-
-            // Vdd - Vth, normalized so that translated values can be subtracted:
-            // k*Vddt - x = (k*Vddt - t) - (x - t)
-            mf.kVddt = (int)(N16*(kVddt - vmin) + 0.5);
-
-            // Normalized snake current factor, 1 cycle at 1MHz.
-            // Fit in 5 bits.
-            mf.n_snake = (int)(denorm*(1 << 13)*(fi.uCox/(2*fi.k)*fi.WL_snake*1.0e-6/fi.C) + 0.5);
-
-            // Create lookup table mapping op-amp voltage across output and input
-            // to input voltage: vo - vx -> vx
-            // FIXME: No variable length arrays in ISO C++, hardcoding to max 50
-            // points.
-            // double_point scaled_voltage[fi.opamp_voltage_size];
-            double_point scaled_voltage[50];
-
-            for (int i = 0; i < fi.opamp_voltage_size; i++) {
-                // The target output range is 16 bits, in order to fit in an unsigned
-                // short.
-                //
-                // The y axis is temporarily scaled to 31 bits for maximum accuracy in
-                // the calculated derivative.
-                //
-                // Values are normalized using
-                //
-                //   x_n = m*2^N*(x - xmin)
-                //
-                // and are translated back later (for fixed point math) using
-                //
-                //   m*2^N*x = x_n - m*2^N*xmin
-                //
-                scaled_voltage[fi.opamp_voltage_size - 1 - i][0] = int((N16*(fi.opamp_voltage[i][1] - fi.opamp_voltage[i][0]) + (1 << 16))/2 + 0.5);
-                scaled_voltage[fi.opamp_voltage_size - 1 - i][1] = N31*(fi.opamp_voltage[i][0] - vmin);
-            }
+    {
+        model_filter_init_t& fi = model_filter_init[model];
+        model_filter_t& mf = model_filter[model];
+
+        // Convert op-amp voltage transfer to 16 bit values.
+        double vmin = fi.opamp_voltage[0][0];
+        double opamp_max = fi.opamp_voltage[0][1];
+        double kVddt = fi.k*(fi.Vdd - fi.Vth);
+        double vmax = kVddt < opamp_max ? opamp_max : kVddt;
+        double denorm = vmax - vmin;
+        double norm = 1.0/denorm;
+
+        // Scaling and translation constants.
+        double N16 = norm*((1u << 16) - 1);
+        double N30 = norm*((1u << 30) - 1);
+        double N31 = norm*((1u << 31) - 1);
+        mf.vo_N16 = (int)(N16);  // FIXME: Remove?
+
+        // The "zero" output level of the voices.
+        // The digital range of one voice is 20 bits; create a scaling term
+        // for multiplication which fits in 11 bits.
+        double N14 = norm*(1u << 14);
+        mf.voice_scale_s14 = (int)(N14*fi.voice_voltage_range);
+        mf.voice_DC = (int)(N16*(fi.voice_DC_voltage - vmin));
+
+        // Vdd - Vth, normalized so that translated values can be subtracted:
+        // k*Vddt - x = (k*Vddt - t) - (x - t)
+        mf.kVddt = (int)(N16*(kVddt - vmin) + 0.5);
+
+        // Normalized snake current factor, 1 cycle at 1MHz.
+        // Fit in 5 bits.
+        mf.n_snake = (int)(denorm*(1 << 13)*(fi.uCox/(2*fi.k)*fi.WL_snake*1.0e-6/fi.C) + 0.5);
+
+        // Create lookup table mapping op-amp voltage across output and input
+        // to input voltage: vo - vx -> vx
+        // FIXME: No variable length arrays in ISO C++, hardcoding to max 50
+        // points.
+        // double_point scaled_voltage[fi.opamp_voltage_size];
+        double_point scaled_voltage[50];
+
+        for (int i = 0; i < fi.opamp_voltage_size; i++) {
+            // The target output range is 16 bits, in order to fit in an unsigned
+            // short.
+            //
+            // The y axis is temporarily scaled to 31 bits for maximum accuracy in
+            // the calculated derivative.
+            //
+            // Values are normalized using
+            //
+            //   x_n = m*2^N*(x - xmin)
+            //
+            // and are translated back later (for fixed point math) using
+            //
+            //   m*2^N*x = x_n - m*2^N*xmin
+            //
+            scaled_voltage[fi.opamp_voltage_size - 1 - i][0] = int((N16*(fi.opamp_voltage[i][1] - fi.opamp_voltage[i][0]) + (1 << 16))/2 + 0.5);
+            scaled_voltage[fi.opamp_voltage_size - 1 - i][1] = N31*(fi.opamp_voltage[i][0] - vmin);
+        }
 
-            // Clamp x to 16 bits (rounding may cause overflow).
-            if (scaled_voltage[fi.opamp_voltage_size - 1][0] >= (1 << 16)) {
-                // The last point is repeated.
-                scaled_voltage[fi.opamp_voltage_size - 1][0] =
-                scaled_voltage[fi.opamp_voltage_size - 2][0] = (1 << 16) - 1;
-            }
+        // Clamp x to 16 bits (rounding may cause overflow).
+        if (scaled_voltage[fi.opamp_voltage_size - 1][0] >= (1 << 16)) {
+            // The last point is repeated.
+            scaled_voltage[fi.opamp_voltage_size - 1][0] =
+            scaled_voltage[fi.opamp_voltage_size - 2][0] = (1 << 16) - 1;
+        }
 
-            interpolate(scaled_voltage, scaled_voltage + fi.opamp_voltage_size - 1,
-                PointPlotter<unsigned int>(voltages), 1.0);
+        interpolate(scaled_voltage, scaled_voltage + fi.opamp_voltage_size - 1,
+            PointPlotter<unsigned int>(voltages), 1.0);
 
-            // Store both fn and dfn in the same table.
-            mf.ak = (int)scaled_voltage[0][0];
-            mf.bk = (int)scaled_voltage[fi.opamp_voltage_size - 1][0];
-            int j;
-            for (j = 0; j < mf.ak; j++) {
-                opamp[j].vx = 0;
-                opamp[j].dvx = 0;
-            }
-            unsigned int f = voltages[j];
-            for (; j <= mf.bk; j++) {
-                unsigned int fp = f;
-                f = voltages[j];  // Scaled by m*2^31
-                // m*2^31*dy/1 = (m*2^31*dy)/(m*2^16*dx) = 2^15*dy/dx
-                int df = f - fp;  // Scaled by 2^15
-
-                // 16 bits unsigned: m*2^16*(fn - xmin)
-                opamp[j].vx = f > (0xffff << 15) ? 0xffff : f >> 15;
-                // 16 bits (15 bits + sign bit): 2^11*dfn
-                opamp[j].dvx = df >> (15 - 11);
-            }
-            for (; j < (1 << 16); j++) {
-                opamp[j].vx = 0;
-                opamp[j].dvx = 0;
-            }
+        // Store both fn and dfn in the same table.
+        mf.ak = (int)scaled_voltage[0][0];
+        mf.bk = (int)scaled_voltage[fi.opamp_voltage_size - 1][0];
+        int j;
+        for (j = 0; j < mf.ak; j++) {
+            opamp[j].vx = 0;
+            opamp[j].dvx = 0;
+        }
+        unsigned int f = voltages[j];
+        for (; j <= mf.bk; j++) {
+            unsigned int fp = f;
+            f = voltages[j];  // Scaled by m*2^31
+            // m*2^31*dy/1 = (m*2^31*dy)/(m*2^16*dx) = 2^15*dy/dx
+            int df = f - fp;  // Scaled by 2^15
+
+            // 16 bits unsigned: m*2^16*(fn - xmin)
+            opamp[j].vx = f > (0xffff << 15) ? 0xffff : f >> 15;
+            // 16 bits (15 bits + sign bit): 2^11*dfn
+            opamp[j].dvx = df >> (15 - 11);
+        }
+        for (; j < (1 << 16); j++) {
+            opamp[j].vx = 0;
+            opamp[j].dvx = 0;
+        }
 
-            // Create lookup tables for gains / summers.
-
-            // 4 bit "resistor" ladders in the bandpass resonance gain and the audio
-            // output gain necessitate 16 gain tables.
-            // From die photographs of the bandpass and volume "resistor" ladders
-            // it follows that gain ~ vol/8 and 1/Q ~ ~res/8 (assuming ideal
-            // op-amps and ideal "resistors").
-            for (int n8 = 0; n8 < 16; n8++) {
-                int n = n8 << 4;  // Scaled by 2^7
-                int x = mf.ak;
-                for (int vi = 0; vi < (1 << 16); vi++) {
-                    mf.gain[n8][vi] = solve_gain(opamp, n, vi, x, mf);
-                }
+        // Create lookup tables for gains / summers.
+
+        // 4 bit "resistor" ladders in the bandpass resonance gain and the audio
+        // output gain necessitate 16 gain tables.
+        // From die photographs of the bandpass and volume "resistor" ladders
+        // it follows that gain ~ vol/8 and 1/Q ~ ~res/8 (assuming ideal
+        // op-amps and ideal "resistors").
+        for (int n8 = 0; n8 < 16; n8++) {
+            int n = n8 << 4;  // Scaled by 2^7
+            int x = mf.ak;
+            for (int vi = 0; vi < (1 << 16); vi++) {
+                mf.gain[n8][vi] = solve_gain(opamp, n, vi, x, mf);
             }
+        }
 
-            // The filter summer operates at n ~ 1, and has 5 fundamentally different
-            // input configurations (2 - 6 input "resistors").
-            //
-            // Note that all "on" transistors are modeled as one. This is not
-            // entirely accurate, since the input for each transistor is different,
-            // and transistors are not linear components. However modeling all
-            // transistors separately would be extremely costly.
-            int offset = 0;
-            int size;
-            for (int k = 0; k < 5; k++) {
-                int idiv = 2 + k;        // 2 - 6 input "resistors".
-                int n_idiv = idiv << 7;  // n*idiv, scaled by 2^7
-                size = idiv << 16;
-                int x = mf.ak;
-                for (int vi = 0; vi < size; vi++) {
-                    mf.summer[offset + vi] = solve_gain(opamp, n_idiv, vi/idiv, x, mf);
-                }
-                offset += size;
+        // The filter summer operates at n ~ 1, and has 5 fundamentally different
+        // input configurations (2 - 6 input "resistors").
+        //
+        // Note that all "on" transistors are modeled as one. This is not
+        // entirely accurate, since the input for each transistor is different,
+        // and transistors are not linear components. However modeling all
+        // transistors separately would be extremely costly.
+        int offset = 0;
+        int size;
+        for (int k = 0; k < 5; k++) {
+            int idiv = 2 + k;        // 2 - 6 input "resistors".
+            int n_idiv = idiv << 7;  // n*idiv, scaled by 2^7
+            size = idiv << 16;
+            int x = mf.ak;
+            for (int vi = 0; vi < size; vi++) {
+                mf.summer[offset + vi] = solve_gain(opamp, n_idiv, vi/idiv, x, mf);
             }
+            offset += size;
+        }
 
-            // The audio mixer operates at n ~ 8/6, and has 8 fundamentally different
-            // input configurations (0 - 7 input "resistors").
-            //
-            // All "on", transistors are modeled as one - see comments above for
-            // the filter summer.
-            offset = 0;
-            size = 1;  // Only one lookup element for 0 input "resistors".
-            for (int l = 0; l < 8; l++) {
-                int idiv = l;                 // 0 - 7 input "resistors".
-                int n_idiv = (idiv << 7)*8/6; // n*idiv, scaled by 2^7
-                if (idiv == 0) {
-                    // Avoid division by zero; the result will be correct since
-                    // n_idiv = 0.
-                    idiv = 1;
-                }
-                int x = mf.ak;
-                for (int vi = 0; vi < size; vi++) {
-                    mf.mixer[offset + vi] = solve_gain(opamp, n_idiv, vi/idiv, x, mf);
-                }
-                offset += size;
-                size = (l + 1) << 16;
+        // The audio mixer operates at n ~ 8/6, and has 8 fundamentally different
+        // input configurations (0 - 7 input "resistors").
+        //
+        // All "on", transistors are modeled as one - see comments above for
+        // the filter summer.
+        offset = 0;
+        size = 1;  // Only one lookup element for 0 input "resistors".
+        for (int l = 0; l < 8; l++) {
+            int idiv = l;                 // 0 - 7 input "resistors".
+            int n_idiv = (idiv << 7)*8/6; // n*idiv, scaled by 2^7
+            if (idiv == 0) {
+                // Avoid division by zero; the result will be correct since
+                // n_idiv = 0.
+                idiv = 1;
             }
-
-            // Create lookup table mapping capacitor voltage to op-amp input voltage:
-            // vc -> vx
-            for (int m = 0; m < (1 << 16); m++) {
-                mf.opamp_rev[m] = opamp[m].vx;
+            int x = mf.ak;
+            for (int vi = 0; vi < size; vi++) {
+                mf.mixer[offset + vi] = solve_gain(opamp, n_idiv, vi/idiv, x, mf);
             }
+            offset += size;
+            size = (l + 1) << 16;
+        }
+
+        // Create lookup table mapping capacitor voltage to op-amp input voltage:
+        // vc -> vx
+        for (int m = 0; m < (1 << 16); m++) {
+            mf.opamp_rev[m] = opamp[m].vx;
+        }
 
-            mf.vc_max = (int)(N30*(fi.opamp_voltage[0][1] - fi.opamp_voltage[0][0]));
-            mf.vc_min = (int)(N30*(fi.opamp_voltage[fi.opamp_voltage_size - 1][1] - fi.opamp_voltage[fi.opamp_voltage_size - 1][0]));
+        mf.vc_max = (int)(N30*(fi.opamp_voltage[0][1] - fi.opamp_voltage[0][0]));
+        mf.vc_min = (int)(N30*(fi.opamp_voltage[fi.opamp_voltage_size - 1][1] - fi.opamp_voltage[fi.opamp_voltage_size - 1][0]));
 
-            // DAC table.
-            int bits = 11;
-            build_dac_table(mf.f0_dac, bits, fi.dac_2R_div_R, fi.dac_term);
-            for (int n = 0; n < (1 << bits); n++) {
-                mf.f0_dac[n] = (unsigned short)(N16*(fi.dac_zero + mf.f0_dac[n]*fi.dac_scale/(1 << bits) - vmin) + 0.5);
-            }
+        // DAC table.
+        int bits = 11;
+        build_dac_table(mf.f0_dac, bits, fi.dac_2R_div_R, fi.dac_term);
+        for (int n = 0; n < (1 << bits); n++) {
+            mf.f0_dac[n] = (unsigned short)(N16*(fi.dac_zero + mf.f0_dac[n]*fi.dac_scale/(1 << bits) - vmin) + 0.5);
         }
+    }
 
-        // Free temporary tables.
-        delete[] voltages;
-        delete[] opamp;
+    // Free temporary tables.
+    delete[] voltages;
+    delete[] opamp;
 
+    if (model == 0) {
         // VCR - 6581 only.
         model_filter_init_t& fi = model_filter_init[0];
 
@@ -421,10 +442,32 @@ Filter::Filter()
             // Scaled by m*2^15
             vcr_n_Ids_term[kVg_Vx] = (unsigned short)(n_Is*log_term*log_term);
         }
-
-        class_init = true;
     }
 
+    materialized[model] = true;
+}
+#else
+// Tables generated at build time reside in shared read-only data;
+// there is nothing to materialize.
+void Filter::materialize_tables(int)
+{
+}
+#endif // !RESID_PREBUILT_FILTER_TABLES
+
+
+// ----------------------------------------------------------------------------
+// Constructor.
+// ----------------------------------------------------------------------------
+Filter::Filter()
+{
+    // Per instance parameters; set_chip_model below re-derives the
+    // cutoff parameters from these.
+    Vw_bias = 0;
+    fc = 0;
+    res = 0;
+
+    fast_filter = false;
+
     enable_filter(true);
     set_chip_model(MOS6581);
     set_voice_mask(0x07);
@@ -433,6 +476,103 @@ Filter::Filter()
 }
 
 
+// ----------------------------------------------------------------------------
+// Fast filter mode support tables.
+//
+// Approximate FC -> cutoff frequency mapping, interpolated from measured
+// data points and converted to the fixed point w0 representation used by
+// clock_fast.
+// ----------------------------------------------------------------------------
+typedef double fc_point[2];
+
+static const fc_point f0_points_6581[] =
+{
+  //  FC      f         FCHI FCLO
+  // ----------------------------
+  {    0,   220 },   // 0x00      - repeated end point
+  {    0,   220 },   // 0x00
+  {  128,   230 },   // 0x10
+  {  256,   250 },   // 0x20
+  {  384,   300 },   // 0x30
+  {  512,   420 },   // 0x40
+  {  640,   780 },   // 0x50
+  {  768,  1600 },   // 0x60
+  {  832,  2300 },   // 0x68
+  {  896,  3200 },   // 0x70
+  {  960,  4300 },   // 0x78
+  {  992,  5000 },   // 0x7c
+  { 1008,  5400 },   // 0x7e
+  { 1016,  5700 },   // 0x7f
+  { 1023,  6000 },   // 0x7f 0x07
+  { 1023,  6000 },   // 0x7f 0x07 - discontinuity
+  { 1024,  4600 },   // 0x80      -
+  { 1024,  4600 },   // 0x80
+  { 1032,  4800 },   // 0x81
+  { 1056,  5300 },   // 0x84
+  { 1088,  6000 },   // 0x88
+  { 1120,  6600 },   // 0x8c
+  { 1152,  7200 },   // 0x90
+  { 1280,  9500 },   // 0xa0
+  { 1408, 12000 },   // 0xb0
+  { 1536, 14500 },   // 0xc0
+  { 1664, 16000 },   // 0xd0
+  { 1792, 17100 },   // 0xe0
+  { 1920, 17700 },   // 0xf0
+  { 2047, 18000 },   // 0xff 0x07
+  { 2047, 18000 }    // 0xff 0x07 - repeated end point
+};
+
+static const fc_point f0_points_8580[] =
+{
+  //  FC      f         FCHI FCLO
+  // ----------------------------
+  {    0,     0 },   // 0x00      - repeated end point
+  {    0,     0 },   // 0x00
+  {  128,   800 },   // 0x10
+  {  256,  1600 },   // 0x20
+  {  384,  2500 },   // 0x30
+  {  512,  3300 },   // 0x40
+  {  640,  4100 },   // 0x50
+  {  768,  4800 },   // 0x60
+  {  896,  5600 },   // 0x70
+  { 1024,  6500 },   // 0x80
+  { 1152,  7500 },   // 0x90
+  { 1280,  8400 },   // 0xa0
+  { 1408,  9200 },   // 0xb0
+  { 1536,  9800 },   // 0xc0
+  { 1664, 10500 },   // 0xd0
+  { 1792, 11000 },   // 0xe0
+  { 1920, 11700 },   // 0xf0
+  { 2047, 12500 },   // 0xff 0x07
+  { 2047, 12500 }    // 0xff 0x07 - repeated end point
+};
+
+int Filter::w0_fast[2][1 << 11];
+
+bool Filter::fast_class_init_tables()
+{
+    interpolate(f0_points_6581,
+                f0_points_6581
+                + sizeof(f0_points_6581)/sizeof(*f0_points_6581) - 1,
+                PointPlotter<int>(w0_fast[0]), 1.0);
+    interpolate(f0_points_8580,
+                f0_points_8580
+                + sizeof(f0_points_8580)/sizeof(*f0_points_8580) - 1,
+                PointPlotter<int>(w0_fast[1]), 1.0);
+
+    // Convert f0 to w0 = 2*pi*f0, scaled by 2^20/1e6 per cycle.
+    for (int m = 0; m < 2; m++) {
+        for (int i = 0; i < (1 << 11); i++) {
+            w0_fast[m][i] = int(2*3.1415926535897932385*w0_fast[m][i]*1.048576);
+        }
+    }
+
+    return true;
+}
+
+bool Filter::fast_class_init = Filter::fast_class_init_tables();
+
+
 // ----------------------------------------------------------------------------
 // Enable filter.
 // ----------------------------------------------------------------------------
@@ -443,6 +583,21 @@ void Filter::enable_filter(bool enable)
 }
 
 
+// ----------------------------------------------------------------------------
+// Select the fast filter mode.
+// ----------------------------------------------------------------------------
+void Filter::enable_fast_filter(bool enable)
+{
+    fast_filter = enable;
+
+    // The two modes use different state variable scaling; restart from
+    // silence.
+    Vhp = 0;
+    Vbp = Vbp_x = Vbp_vc = 0;
+    Vlp = Vlp_x = Vlp_vc = 0;
+}
+
+
 // ----------------------------------------------------------------------------
 // Adjust the DAC bias parameter of the filter.
 // This gives user variable control of the exact CF -> center frequency
@@ -461,6 +616,10 @@ void Filter::adjust_filter_bias(double dac_bias)
 void Filter::set_chip_model(chip_model model)
 {
     sid_model = model;
+    materialize_tables(model);
+    // The cutoff parameters computed on the last FC register write refer
+    // to the previous model; re-derive them for the new one.
+    set_w0();
     /* We initialize the state variables again just to make sure that
     * the earlier model didn't leave behind some foreign, unrecoverable
     * state. Hopefully set_chip_model() only occurs simultaneously with
@@ -640,6 +799,9 @@ modeled in the MOS 8580:
 */
 void Filter::set_Q()
 {
+    // Fast mode resonance; 1/Q is controlled linearly by res.
+    q_1024_div = int(1024.0/(0.707 + 1.0*res/0x0f));
+
     // Cutoff for MOS 6581.
     // The coefficient 8 is dispensed of later by right-shifting 3 times
     // (2 ^ 3 = 8).
@@ -28,6 +28,7 @@
 #include "dac.h"
 #include "spline.h"
 #include <math.h>
+#include <mutex>
 
 namespace reSID
 {
@@ -104,54 +105,6 @@ static double_point opamp_voltage_8580[] = {
 };
 
 
-/*
- * R1 = 15.3*Ri
- * R2 =  7.3*Ri
- * R3 =  4.7*Ri
- * Rf =  1.4*Ri
- * R4 =  1.4*Ri
- * R8 =  2.0*Ri
- * RC =  2.8*Ri
- *
- * res  feedback  input
- * ---  --------  -----
- *  0   Rf        Ri
- *  1   Rf|R1     Ri
- *  2   Rf|R2     Ri
- *  3   Rf|R3     Ri
- *  4   Rf        R4
- *  5   Rf|R1     R4
- *  6   Rf|R2     R4
- *  7   Rf|R3     R4
- *  8   Rf        R8
- *  9   Rf|R1     R8
- *  A   Rf|R2     R8
- *  B   Rf|R3     R8
- *  C   Rf        RC
- *  D   Rf|R1     RC
- *  E   Rf|R2     RC
- *  F   Rf|R3     RC
- */
-static double resGain[16] =
-{
-  ((1.4/1.0)),                     //      Rf/Ri   1.4
-  ((((1.4*15.3)/(1.4+15.3))/1.0)), // (Rf|R1)/Ri   1.28263
-  ((((1.4*7.3)/(1.4+7.3))/1.0)),   // (Rf|R2)/Ri   1.17471
-  ((((1.4*4.7)/(1.4+4.7))/1.0)),   // (Rf|R3)/Ri   1.07869
-  ((1.4/1.4)),                     //      Rf/R4   1.0
-  ((((1.4*15.3)/(1.4+15.3))/1.4)), // (Rf|R1)/R4   0.916168
-  ((((1.4*7.3)/(1.4+7.3))/1.4)),   // (Rf|R2)/R4   0.83908
-  ((((1.4*4.7)/(1.4+4.7))/1.4)),   // (Rf|R3)/R4   0.770492
-  ((1.4/2.0)),                     //      Rf/R8   0.7
-  ((((1.4*15.3)/(1.4+15.3))/2.0)), // (Rf|R1)/R8   0.641317
-  ((((1.4*7.3)/(1.4+7.3))/2.0)),   // (Rf|R2)/R8   0.587356
-  ((((1.4*4.7)/(1.4+4.7))/2.0)),   // (Rf|R3)/R8   0.539344
-  ((1.4/2.8)),                     //      Rf/RC   0.5
-  ((((1.4*15.3)/(1.4+15.3))/2.8)), // (Rf|R1)/RC   0.458084
-  ((((1.4*7.3)/(1.4+7.3))/2.8)),   // (Rf|R2)/RC   0.41954
-  ((((1.4*4.7)/(1.4+4.7))/2.8)),   // (Rf|R3)/RC   0.385246
-};
-
 typedef struct {
   // Op-amp transfer function.
   double_point* opamp_voltage;
@@ -225,11 +178,6 @@ static model_filter_init_t model_filter_init[2] = {
   }
 };
 
-unsigned short Filter::vcr_kVg[1 << 16];
-unsigned short Filter::vcr_n_Ids_term[1 << 16];
-int Filter::n_snake;
-int Filter::n_param;
-
 #if defined(__amiga__) && defined(__mc68000__)
 #undef HAS_LOG1P
 #endif
@@ -241,386 +189,495 @@ static double log1p(double x)
 }
 #endif
 
+#if RESID_PREBUILT_FILTER_TABLES
+// Fully initialized tables generated at build time by genfilttables,
+// residing in shared read-only data.
+#include "filter_tables.h"
+#else
+unsigned short Filter::vcr_kVg[1 << 16];
+unsigned short Filter::vcr_n_Ids_term[1 << 16];
+int Filter::n_snake;
+int Filter::n_param;
+
 Filter::model_filter_t Filter::model_filter[2];
+#endif
 
 // The 4.75V voltage for the virtual ground is generated by a PolySi resistor divider
 static const double Vref = 4.75;
 
+// The vo_N16 scaling constant of a model, derived directly from the
+// measured parameters. Used where a model's scaling is needed without
+// materializing its tables.
+static double vo_N16_scalar(int m)
+{
+  model_filter_init_t& fi = model_filter_init[m];
+  double vmin = fi.opamp_voltage[0][0];
+  double opamp_max = fi.opamp_voltage[0][1];
+  double kVddt = fi.k*(fi.Vdd - fi.Vth);
+  double vmax = kVddt < opamp_max ? opamp_max : kVddt;
+  double norm = 1.0/(vmax - vmin);
+  return norm*((1u << 16) - 1);
+}
+
+#if !RESID_PREBUILT_FILTER_TABLES
+/*
+ * R1 = 15.3*Ri
+ * R2 =  7.3*Ri
+ * R3 =  4.7*Ri
+ * Rf =  1.4*Ri
+ * R4 =  1.4*Ri
+ * R8 =  2.0*Ri
+ * RC =  2.8*Ri
+ *
+ * res  feedback  input
+ * ---  --------  -----
+ *  0   Rf        Ri
+ *  1   Rf|R1     Ri
+ *  2   Rf|R2     Ri
+ *  3   Rf|R3     Ri
+ *  4   Rf        R4
+ *  5   Rf|R1     R4
+ *  6   Rf|R2     R4
+ *  7   Rf|R3     R4
+ *  8   Rf        R8
+ *  9   Rf|R1     R8
+ *  A   Rf|R2     R8
+ *  B   Rf|R3     R8
+ *  C   Rf        RC
+ *  D   Rf|R1     RC
+ *  E   Rf|R2     RC
+ *  F   Rf|R3     RC
+ */
+static double resGain[16] =
+{
+  ((1.4/1.0)),                     //      Rf/Ri   1.4
+  ((((1.4*15.3)/(1.4+15.3))/1.0)), // (Rf|R1)/Ri   1.28263
+  ((((1.4*7.3)/(1.4+7.3))/1.0)),   // (Rf|R2)/Ri   1.17471
+  ((((1.4*4.7)/(1.4+4.7))/1.0)),   // (Rf|R3)/Ri   1.07869
+  ((1.4/1.4)),                     //      Rf/R4   1.0
+  ((((1.4*15.3)/(1.4+15.3))/1.4)), // (Rf|R1)/R4   0.916168
+  ((((1.4*7.3)/(1.4+7.3))/1.4)),   // (Rf|R2)/R4   0.83908
+  ((((1.4*4.7)/(1.4+4.7))/1.4)),   // (Rf|R3)/R4   0.770492
+  ((1.4/2.0)),                     //      Rf/R8   0.7
+  ((((1.4*15.3)/(1.4+15.3))/2.0)), // (Rf|R1)/R8   0.641317
+  ((((1.4*7.3)/(1.4+7.3))/2.0)),   // (Rf|R2)/R8   0.587356
+  ((((1.4*4.7)/(1.4+4.7))/2.0)),   // (Rf|R3)/R8   0.539344
+  ((1.4/2.8)),                     //      Rf/RC   0.5
+  ((((1.4*15.3)/(1.4+15.3))/2.8)), // (Rf|R1)/RC   0.458084
+  ((((1.4*7.3)/(1.4+7.3))/2.8)),   // (Rf|R2)/RC   0.41954
+  ((((1.4*4.7)/(1.4+4.7))/2.8)),   // (Rf|R3)/RC   0.385246
+};
+
 // ----------------------------------------------------------------------------
-// Constructor.
+// Lazy one-time initialization of the static filter tables.
+//
+// The tables amount to several megabytes per chip model, and are only
+// materialized when a model is first selected, so that processes which
+// only ever emulate one model do not pay for the other. Initialization
+// is serialized with a mutex so that SID instances can be constructed
+// and reconfigured from worker threads.
 // ----------------------------------------------------------------------------
-Filter::Filter()
+static std::mutex materialize_mutex;
+static bool materialized[2];
+
+void Filter::materialize_tables(int model)
 {
-  static bool class_init;
-
-  if (!class_init) {
-    double tmp_n_param[2];
-
-    unsigned int dac_bits = 11;
-
-    // Temporary tables for op-amp transfer function.
-    unsigned int* voltages = new unsigned int[1 << 16];
-    opamp_t* opamp = new opamp_t[1 << 16];
-
-    for (int m = 0; m < 2; m++) {
-      model_filter_init_t& fi = model_filter_init[m];
-      model_filter_t& mf = model_filter[m];
-
-      // Convert op-amp voltage transfer to 16 bit values.
-      double vmin = fi.opamp_voltage[0][0];
-      double opamp_max = fi.opamp_voltage[0][1];
-      double kVddt = fi.k*(fi.Vdd - fi.Vth);
-      double vmax = kVddt < opamp_max ? opamp_max : kVddt;
-      double denorm = vmax - vmin;
-      double norm = 1.0/denorm;
-
-      // Scaling and translation constants.
-      double N16 = norm*((1u << 16) - 1);
-      double N30 = norm*((1u << 30) - 1);
-      double N31 = norm*((1u << 31) - 1);
-      mf.vo_N16 = N16;
-
-      // The "zero" output level of the voices.
-      // The digital range of one voice is 20 bits; create a scaling term
-      // for multiplication which fits in 11 bits.
-      double N14 = norm*(1u << 14);
-      mf.voice_scale_s14 = (int)(N14*fi.voice_voltage_range);
-      mf.voice_DC = (int)(N16*(fi.voice_DC_voltage - vmin));
-
-      // Vdd - Vth, normalized so that translated values can be subtracted:
-      // k*Vddt - x = (k*Vddt - t) - (x - t)
-      mf.kVddt = (int)(N16*(kVddt - vmin) + 0.5);
-
-      tmp_n_param[m] = denorm*(1 << 13)*((fi.uCox/2.)*1.0e-6/fi.C);
-
-      // Create lookup table mapping op-amp voltage across output and input
-      // to input voltage: vo - vx -> vx
-      // FIXME: No variable length arrays in ISO C++, hardcoding to max 50
-      // points.
-      // double_point scaled_voltage[fi.opamp_voltage_size];
-      double_point scaled_voltage[50];
-
-      for (int i = 0; i < fi.opamp_voltage_size; i++) {
-        // The target output range is 16 bits, in order to fit in an unsigned
-        // short.
-        //
-        // The y axis is temporarily scaled to 31 bits for maximum accuracy in
-        // the calculated derivative.
-        //
-        // Values are normalized using
-        //
-        //   x_n = m*2^N*(x - xmin)
-        //
-        // and are translated back later (for fixed point math) using
-        //
-        //   m*2^N*x = x_n - m*2^N*xmin
-        //
-        scaled_voltage[fi.opamp_voltage_size - 1 - i][0] = N16*(fi.opamp_voltage[i][1] - fi.opamp_voltage[i][0])/2.;
-        // Translate value to the positive axis by adding 32768
-        // The same is done later in the integrator function when accessing the opamp array
-        scaled_voltage[fi.opamp_voltage_size - 1 - i][0] += double(1 << 15);
-        scaled_voltage[fi.opamp_voltage_size - 1 - i][1] = N31*(fi.opamp_voltage[i][0] - vmin);
-      }
+  std::lock_guard<std::mutex> lock(materialize_mutex);
 
-      // Clamp x to 16 bit range (rounding may cause overflow).
-      if (scaled_voltage[fi.opamp_voltage_size - 1][0] > 65535.) {
-        // The last point is repeated.
-        scaled_voltage[fi.opamp_voltage_size - 1][0] =
-            scaled_voltage[fi.opamp_voltage_size - 2][0] = 65535.;
-      }
+  if (materialized[model]) {
+    return;
+  }
+
+  double tmp_n_param;
+
+  unsigned int dac_bits = 11;
 
-      interpolate(scaled_voltage, scaled_voltage + fi.opamp_voltage_size - 1,
-                    PointPlotter<unsigned int>(voltages), 1.0);
+  // Temporary tables for op-amp transfer function.
+  unsigned int* voltages = new unsigned int[1 << 16];
+  opamp_t* opamp = new opamp_t[1 << 16];
 
-      // Store both fn and dfn in the same table.
-      mf.ak = (int)(scaled_voltage[0][0] + 0.5);
-      mf.bk = (int)(scaled_voltage[fi.opamp_voltage_size - 1][0] + 0.5);
-      int j;
-      for (j = 0; j < mf.ak; j++) {
-        opamp[j].vx = 0;
-        opamp[j].dvx = 0;
+  {
+    model_filter_init_t& fi = model_filter_init[model];
+    model_filter_t& mf = model_filter[model];
+
+    // Convert op-amp voltage transfer to 16 bit values.
+    double vmin = fi.opamp_voltage[0][0];
+    double opamp_max = fi.opamp_voltage[0][1];
+    double kVddt = fi.k*(fi.Vdd - fi.Vth);
+    double vmax = kVddt < opamp_max ? opamp_max : kVddt;
+    double denorm = vmax - vmin;
+    double norm = 1.0/denorm;
+
+    // Scaling and translation constants.
+    double N16 = norm*((1u << 16) - 1);
+    double N30 = norm*((1u << 30) - 1);
+    double N31 = norm*((1u << 31) - 1);
+    mf.vo_N16 = N16;
+
+    // The "zero" output level of the voices.
+    // The digital range of one voice is 20 bits; create a scaling term
+    // for multiplication which fits in 11 bits.
+    double N14 = norm*(1u << 14);
+    mf.voice_scale_s14 = (int)(N14*fi.voice_voltage_range);
+    mf.voice_DC = (int)(N16*(fi.voice_DC_voltage - vmin));
+
+    // Vdd - Vth, normalized so that translated values can be subtracted:
+    // k*Vddt - x = (k*Vddt - t) - (x - t)
+    mf.kVddt = (int)(N16*(kVddt - vmin) + 0.5);
+
+    tmp_n_param = denorm*(1 << 13)*((fi.uCox/2.)*1.0e-6/fi.C);
+
+    // Create lookup table mapping op-amp voltage across output and input
+    // to input voltage: vo - vx -> vx
+    // FIXME: No variable length arrays in ISO C++, hardcoding to max 50
+    // points.
+    // double_point scaled_voltage[fi.opamp_voltage_size];
+    double_point scaled_voltage[50];
+
+    for (int i = 0; i < fi.opamp_voltage_size; i++) {
+      // The target output range is 16 bits, in order to fit in an unsigned
+      // short.
+      //
+      // The y axis is temporarily scaled to 31 bits for maximum accuracy in
+      // the calculated derivative.
+      //
+      // Values are normalized using
+      //
+      //   x_n = m*2^N*(x - xmin)
+      //
+      // and are translated back later (for fixed point math) using
+      //
+      //   m*2^N*x = x_n - m*2^N*xmin
+      //
+      scaled_voltage[fi.opamp_voltage_size - 1 - i][0] = N16*(fi.opamp_voltage[i][1] - fi.opamp_voltage[i][0])/2.;
+      // Translate value to the positive axis by adding 32768
+      // The same is done later in the integrator function when accessing the opamp array
+      scaled_voltage[fi.opamp_voltage_size - 1 - i][0] += double(1 << 15);
+      scaled_voltage[fi.opamp_voltage_size - 1 - i][1] = N31*(fi.opamp_voltage[i][0] - vmin);
+    }
+
+    // Clamp x to 16 bit range (rounding may cause overflow).
+    if (scaled_voltage[fi.opamp_voltage_size - 1][0] > 65535.) {
+      // The last point is repeated.
+      scaled_voltage[fi.opamp_voltage_size - 1][0] =
+          scaled_voltage[fi.opamp_voltage_size - 2][0] = 65535.;
+    }
+
+    interpolate(scaled_voltage, scaled_voltage + fi.opamp_voltage_size - 1,
+                  PointPlotter<unsigned int>(voltages), 1.0);
+
+    // Store both fn and dfn in the same table.
+    mf.ak = (int)(scaled_voltage[0][0] + 0.5);
+    mf.bk = (int)(scaled_voltage[fi.opamp_voltage_size - 1][0] + 0.5);
+    int j;
+    for (j = 0; j < mf.ak; j++) {
+      opamp[j].vx = 0;
+      opamp[j].dvx = 0;
+    }
+    unsigned int f = voltages[j];
+    for (; j < mf.bk; j++) {
+      unsigned int fp = f;
+      f = voltages[j];  // Scaled by m*2^31
+      // m*2^31*dy/1 = (m*2^31*dy)/(m*2^16*dx) = 2^15*dy/dx
+      int df = f - fp;  // Scaled by 2^15
+
+      // 16 bits unsigned: m*2^16*(fn - xmin)
+      opamp[j].vx = f > (0xffff << 15) ? 0xffff : f >> 15;
+      // 16 bits (15 bits + sign bit): 2^11*dfn
+      opamp[j].dvx = df >> (15 - 11);
+    }
+    for (; j < (1 << 16); j++) {
+      opamp[j].vx = 0;
+      opamp[j].dvx = 0;
+    }
+
+    // We don't have the differential for the first point so just assume
+    // it's the same as the second point's
+    opamp[mf.ak].dvx = opamp[mf.ak+1].dvx;
+
+    // Create lookup tables.
+
+    // The filter summer operates at n ~ 1, and has 5 fundamentally different
+    // input configurations (2 - 6 input "resistors").
+    //
+    // Note that all "on" transistors are modeled as one. This is not
+    // entirely accurate, since the input for each transistor is different,
+    // and transistors are not linear components. However modeling all
+    // transistors separately would be extremely costly.
+    int offset = 0;
+    int size;
+    for (int k = 0; k < 5; k++) {
+      int idiv = 2 + k;        // 2 - 6 input "resistors".
+      double n_idiv = double(idiv);
+      size = idiv << 16;
+      int x = mf.ak;
+      for (int vi = 0; vi < size; vi++) {
+        mf.summer[offset + vi] =
+          solve_gain_d(opamp, n_idiv, vi/idiv, x, mf);
       }
-      unsigned int f = voltages[j];
-      for (; j < mf.bk; j++) {
-        unsigned int fp = f;
-        f = voltages[j];  // Scaled by m*2^31
-        // m*2^31*dy/1 = (m*2^31*dy)/(m*2^16*dx) = 2^15*dy/dx
-        int df = f - fp;  // Scaled by 2^15
-
-        // 16 bits unsigned: m*2^16*(fn - xmin)
-        opamp[j].vx = f > (0xffff << 15) ? 0xffff : f >> 15;
-        // 16 bits (15 bits + sign bit): 2^11*dfn
-        opamp[j].dvx = df >> (15 - 11);
+      offset += size;
+    }
+
+    // The audio mixer operates at n ~ 8/6 (6581) 8/5 (8580),
+    // and has 8 fundamentally different
+    // input configurations (0 - 7 input "resistors").
+    //
+    // All "on", transistors are modeled as one - see comments above for
+    // the filter summer.
+    double divider = model==0 ? 6. : 5.;
+    offset = 0;
+    size = 1;  // Only one lookup element for 0 input "resistors".
+    for (int l = 0; l < 8; l++) {
+      int idiv = l;                 // 0 - 7 input "resistors".
+      double n_idiv = double(idiv << 3)/divider; // n*idiv
+      if (idiv == 0) {
+        // Avoid division by zero; the result will be correct since
+        // n_idiv = 0.
+        idiv = 1;
       }
-      for (; j < (1 << 16); j++) {
-        opamp[j].vx = 0;
-        opamp[j].dvx = 0;
+      int x = mf.ak;
+      for (int vi = 0; vi < size; vi++) {
+        mf.mixer[offset + vi] =
+          solve_gain_d(opamp, n_idiv, vi/idiv, x, mf);
       }
+      offset += size;
+      size = (l + 1) << 16;
+    }
 
-      // We don't have the differential for the first point so just assume
-      // it's the same as the second point's
-      opamp[mf.ak].dvx = opamp[mf.ak+1].dvx;
+    // 4 bit "resistor" ladders in the audio
+    // output gain necessitate 16 gain tables.
+    // From die photographs of the volume "resistor" ladders
+    // it follows that gain ~ vol/12 (6581) vol/16 (8580)
+    // (assuming ideal op-amps and ideal "resistors").
+    divider = model==0 ? 12. : 16.;
+    for (int n8 = 0; n8 < 16; n8++) {
+      double n = double(n8) / divider;
+      int x = mf.ak;
+      for (int vi = 0; vi < (1 << 16); vi++) {
+        mf.gain[n8][vi] = solve_gain_d(opamp, n, vi, x, mf);
+      }
+    }
 
-      // Create lookup tables.
+    // Create lookup table mapping capacitor voltage to op-amp input voltage:
+    // vc -> vx
+    for (int i = 0; i < (1 << 16); i++) {
+      mf.opamp_rev[i] = opamp[i].vx;
+    }
 
-      // The filter summer operates at n ~ 1, and has 5 fundamentally different
-      // input configurations (2 - 6 input "resistors").
-      //
-      // Note that all "on" transistors are modeled as one. This is not
-      // entirely accurate, since the input for each transistor is different,
-      // and transistors are not linear components. However modeling all
-      // transistors separately would be extremely costly.
-      int offset = 0;
-      int size;
-      for (int k = 0; k < 5; k++) {
-        int idiv = 2 + k;        // 2 - 6 input "resistors".
-        double n_idiv = double(idiv);
-        size = idiv << 16;
-        int x = mf.ak;
-        for (int vi = 0; vi < size; vi++) {
-          mf.summer[offset + vi] =
-            solve_gain_d(opamp, n_idiv, vi/idiv, x, mf);
-        }
-        offset += size;
-      }
+    mf.vc_max = (int)(N30*(fi.opamp_voltage[0][1] - fi.opamp_voltage[0][0]));
+    mf.vc_min = (int)(N30*(fi.opamp_voltage[fi.opamp_voltage_size - 1][1] - fi.opamp_voltage[fi.opamp_voltage_size - 1][0]));
 
-      // The audio mixer operates at n ~ 8/6 (6581) 8/5 (8580),
-      // and has 8 fundamentally different
-      // input configurations (0 - 7 input "resistors").
-      //
-      // All "on", transistors are modeled as one - see comments above for
-      // the filter summer.
-      double divider = m==0 ? 6. : 5.;
-      offset = 0;
-      size = 1;  // Only one lookup element for 0 input "resistors".
-      for (int l = 0; l < 8; l++) {
-        int idiv = l;                 // 0 - 7 input "resistors".
-        double n_idiv = double(idiv << 3)/divider; // n*idiv
-        if (idiv == 0) {
-          // Avoid division by zero; the result will be correct since
-          // n_idiv = 0.
-          idiv = 1;
-        }
-        int x = mf.ak;
-        for (int vi = 0; vi < size; vi++) {
-          mf.mixer[offset + vi] =
-            solve_gain_d(opamp, n_idiv, vi/idiv, x, mf);
-        }
-        offset += size;
-        size = (l + 1) << 16;
-      }
+    if (model == 0) {
+      // 6581 only
 
-      // 4 bit "resistor" ladders in the audio
-      // output gain necessitate 16 gain tables.
-      // From die photographs of the volume "resistor" ladders
-      // it follows that gain ~ vol/12 (6581) vol/16 (8580)
-      // (assuming ideal op-amps and ideal "resistors").
-      divider = m==0 ? 12. : 16.;
+      // In the MOS 6581, 1/Q is controlled linearly by res. From die photographs
+      // of the resonance "resistor" ladder it follows that 1/Q ~ ~res/8
+      // (assuming an ideal op-amp and ideal "resistors"). This implies that Q
+      // ranges from 0.533 (res = 0) to 8 (res = E). For res = F, Q is actually
+      // theoretically unlimited, which is quite unheard of in a filter
+      // circuit.
+      //
+      // To obtain Q ~ 1/sqrt(2) = 0.707 for maximally flat frequency response,
+      // res should be set to 4: Q = 8/~4 = 8/11 = 0.7272 (again assuming an ideal
+      // op-amp and ideal "resistors").
+      //
+      // Q as low as 0.707 is not achievable because of low gain op-amps; res = 0
+      // should yield the flattest possible frequency response at Q ~ 0.8 - 1.0
+      // in the op-amp's pseudo-linear range (high amplitude signals will be
+      // clipped). As resonance is increased, the filter must be clocked more
+      // often to keep it stable.
       for (int n8 = 0; n8 < 16; n8++) {
-        double n = double(n8) / divider;
+        double n = double(~n8 & 0xf) / 8.;
         int x = mf.ak;
         for (int vi = 0; vi < (1 << 16); vi++) {
-          mf.gain[n8][vi] = solve_gain_d(opamp, n, vi, x, mf);
+          mf.resonance[n8][vi] = solve_gain_d(opamp, n, vi, x, mf);
         }
       }
 
-      // Create lookup table mapping capacitor voltage to op-amp input voltage:
-      // vc -> vx
-      for (int i = 0; i < (1 << 16); i++) {
-        mf.opamp_rev[i] = opamp[i].vx;
-      }
+      // Normalized snake current factor, 1 cycle at 1MHz.
+      // Fit in 5 bits.
+      n_snake = (int)(fi.WL_snake * tmp_n_param + 0.5);
 
-      mf.vc_max = (int)(N30*(fi.opamp_voltage[0][1] - fi.opamp_voltage[0][0]));
-      mf.vc_min = (int)(N30*(fi.opamp_voltage[fi.opamp_voltage_size - 1][1] - fi.opamp_voltage[fi.opamp_voltage_size - 1][0]));
+      // DAC table.
+      build_dac_table(mf.f0_dac, dac_bits, fi.dac_2R_div_R, fi.dac_term);
+      for (int n = 0; n < (1 << dac_bits); n++) {
+        mf.f0_dac[n] = (unsigned short)(N16*(fi.dac_zero + mf.f0_dac[n]*fi.dac_scale/(1 << dac_bits) - vmin) + 0.5);
+      }
 
-      if (m == 0) {
-        // 6581 only
+      // VCR table.
+      double k = fi.k;
+      double kVddt = N16*(k*(fi.Vdd - fi.Vth));
+      vmin *= N16;
 
-        // In the MOS 6581, 1/Q is controlled linearly by res. From die photographs
-        // of the resonance "resistor" ladder it follows that 1/Q ~ ~res/8
-        // (assuming an ideal op-amp and ideal "resistors"). This implies that Q
-        // ranges from 0.533 (res = 0) to 8 (res = E). For res = F, Q is actually
-        // theoretically unlimited, which is quite unheard of in a filter
-        // circuit.
+      for (int i = 0; i < (1 << 16); i++) {
+        // The table index is right-shifted 16 times in order to fit in
+        // 16 bits; the argument to sqrt is thus multiplied by (1 << 16).
         //
-        // To obtain Q ~ 1/sqrt(2) = 0.707 for maximally flat frequency response,
-        // res should be set to 4: Q = 8/~4 = 8/11 = 0.7272 (again assuming an ideal
-        // op-amp and ideal "resistors").
+        // The returned value must be corrected for translation. Vg always
+        // takes part in a subtraction as follows:
         //
-        // Q as low as 0.707 is not achievable because of low gain op-amps; res = 0
-        // should yield the flattest possible frequency response at Q ~ 0.8 - 1.0
-        // in the op-amp's pseudo-linear range (high amplitude signals will be
-        // clipped). As resonance is increased, the filter must be clocked more
-        // often to keep it stable.
-        for (int n8 = 0; n8 < 16; n8++) {
-          double n = double(~n8 & 0xf) / 8.;
-          int x = mf.ak;
-          for (int vi = 0; vi < (1 << 16); vi++) {
-            mf.resonance[n8][vi] = solve_gain_d(opamp, n, vi, x, mf);
-          }
-        }
-
-        Vw_bias = 0;
-
-        // Normalized snake current factor, 1 cycle at 1MHz.
-        // Fit in 5 bits.
-        n_snake = (int)(fi.WL_snake * tmp_n_param[0] + 0.5);
-
-        // DAC table.
-        build_dac_table(mf.f0_dac, dac_bits, fi.dac_2R_div_R, fi.dac_term);
-        for (int n = 0; n < (1 << dac_bits); n++) {
-          mf.f0_dac[n] = (unsigned short)(N16*(fi.dac_zero + mf.f0_dac[n]*fi.dac_scale/(1 << dac_bits) - vmin) + 0.5);
-        }
-
-        // VCR table.
-        double k = fi.k;
-        double kVddt = N16*(k*(fi.Vdd - fi.Vth));
-        vmin *= N16;
-
-        for (int i = 0; i < (1 << 16); i++) {
-          // The table index is right-shifted 16 times in order to fit in
-          // 16 bits; the argument to sqrt is thus multiplied by (1 << 16).
-          //
-          // The returned value must be corrected for translation. Vg always
-          // takes part in a subtraction as follows:
-          //
-          //   k*Vg - Vx = (k*Vg - t) - (Vx - t)
-          //
-          // I.e. k*Vg - t must be returned.
-          double Vg = kVddt - sqrt((double)i*(1 << 16));
-          vcr_kVg[i] = (unsigned short)(k*Vg - vmin + 0.5);
-        }
+        //   k*Vg - Vx = (k*Vg - t) - (Vx - t)
+        //
+        // I.e. k*Vg - t must be returned.
+        double Vg = kVddt - sqrt((double)i*(1 << 16));
+        vcr_kVg[i] = (unsigned short)(k*Vg - vmin + 0.5);
+      }
 
-        /*
-          EKV model:
-
-          Ids = Is*(if - ir)
-          Is = ((2*u*Cox*Ut^2)/k)*W/L
-          if = ln^2(1 + e^((k*(Vg - Vt) - Vs)/(2*Ut))
-          ir = ln^2(1 + e^((k*(Vg - Vt) - Vd)/(2*Ut))
-        */
-        double kVt = fi.k*fi.Vth;
-        double Ut = fi.Ut;
-        double Is = ((2*fi.uCox*Ut*Ut)/fi.k)*fi.WL_vcr;
-        // Normalized current factor for 1 cycle at 1MHz.
-        double N15 = N16/2;
-        double n_Is = N15*1.0e-6/fi.C*Is;
-
-        // kVg_Vx = k*Vg - Vx
-        // I.e. if k != 1.0, Vg must be scaled accordingly.
-        for (int i = 0; i < (1 << 16); i++) {
-          int kVg_Vx = i - (1 << 15);
-          double log_term = log1p(exp((kVg_Vx/N16 - kVt)/(2*Ut)));
-          // Scaled by m*2^15
-          vcr_n_Ids_term[i] = (unsigned short)(n_Is*log_term*log_term);
-        }
-      } else {
-        // 8580 only
+      /*
+        EKV model:
+
+        Ids = Is*(if - ir)
+        Is = ((2*u*Cox*Ut^2)/k)*W/L
+        if = ln^2(1 + e^((k*(Vg - Vt) - Vs)/(2*Ut))
+        ir = ln^2(1 + e^((k*(Vg - Vt) - Vd)/(2*Ut))
+      */
+      double kVt = fi.k*fi.Vth;
+      double Ut = fi.Ut;
+      double Is = ((2*fi.uCox*Ut*Ut)/fi.k)*fi.WL_vcr;
+      // Normalized current factor for 1 cycle at 1MHz.
+      double N15 = N16/2;
+      double n_Is = N15*1.0e-6/fi.C*Is;
+
+      // kVg_Vx = k*Vg - Vx
+      // I.e. if k != 1.0, Vg must be scaled accordingly.
+      for (int i = 0; i < (1 << 16); i++) {
+        int kVg_Vx = i - (1 << 15);
+        double log_term = log1p(exp((kVg_Vx/N16 - kVt)/(2*Ut)));
+        // Scaled by m*2^15
+        vcr_n_Ids_term[i] = (unsigned short)(n_Is*log_term*log_term);
+      }
+    } else {
+      // 8580 only
 
-        // In the MOS 8580, the resonance "resistor" ladder above the bp feedback
-        // op-amp is split in two parts; one ladder for the op-amp input and one
-        // ladder for the op-amp feedback.
-        //
-        // input:         feedback:
-        //
-        //             Rf
-        // Ri R4 RC R8    R3
-        //             R2
-        //             R1
-        //
-        //
-        // The "resistors" are switched in as follows by bits in register $17:
-        //
-        // feedback:
-        // R1: bit4&!bit5
-        // R2: !bit4&bit5
-        // R3: bit4&bit5
-        // Rf: always on
-        //
-        // input:
-        // R4: bit6&!bit7
-        // R8: !bit6&bit7
-        // RC: bit6&bit7
-        // Ri: !(R4|R8|RC) = !(bit6|bit7) = !bit6&!bit7
-        //
-        //
-        // The relative "resistor" values are approximately (using channel length):
-        //
-        // R1 = 15.3*Ri
-        // R2 =  7.3*Ri
-        // R3 =  4.7*Ri
-        // Rf =  1.4*Ri
-        // R4 =  1.4*Ri
-        // R8 =  2.0*Ri
-        // RC =  2.8*Ri
-        //
-        //
-        // Approximate values for 1/Q can now be found as follows (assuming an
-        // ideal op-amp):
-        //
-        // res  feedback  input  -gain (1/Q)
-        // ---  --------  -----  ----------
-        // 0   Rf        Ri     Rf/Ri      = 1/(Ri*(1/Rf))      = 1/0.71
-        // 1   Rf|R1     Ri     (Rf|R1)/Ri = 1/(Ri*(1/Rf+1/R1)) = 1/0.78
-        // 2   Rf|R2     Ri     (Rf|R2)/Ri = 1/(Ri*(1/Rf+1/R2)) = 1/0.85
-        // 3   Rf|R3     Ri     (Rf|R3)/Ri = 1/(Ri*(1/Rf+1/R3)) = 1/0.92
-        // 4   Rf        R4     Rf/R4      = 1/(R4*(1/Rf))      = 1/1.00
-        // 5   Rf|R1     R4     (Rf|R1)/R4 = 1/(R4*(1/Rf+1/R1)) = 1/1.10
-        // 6   Rf|R2     R4     (Rf|R2)/R4 = 1/(R4*(1/Rf+1/R2)) = 1/1.20
-        // 7   Rf|R3     R4     (Rf|R3)/R4 = 1/(R4*(1/Rf+1/R3)) = 1/1.30
-        // 8   Rf        R8     Rf/R8      = 1/(R8*(1/Rf))      = 1/1.43
-        // 9   Rf|R1     R8     (Rf|R1)/R8 = 1/(R8*(1/Rf+1/R1)) = 1/1.56
-        // A   Rf|R2     R8     (Rf|R2)/R8 = 1/(R8*(1/Rf+1/R2)) = 1/1.70
-        // B   Rf|R3     R8     (Rf|R3)/R8 = 1/(R8*(1/Rf+1/R3)) = 1/1.86
-        // C   Rf        RC     Rf/RC      = 1/(RC*(1/Rf))      = 1/2.00
-        // D   Rf|R1     RC     (Rf|R1)/RC = 1/(RC*(1/Rf+1/R1)) = 1/2.18
-        // E   Rf|R2     RC     (Rf|R2)/RC = 1/(RC*(1/Rf+1/R2)) = 1/2.38
-        // F   Rf|R3     RC     (Rf|R3)/RC = 1/(RC*(1/Rf+1/R3)) = 1/2.60
-        //
-        //
-        // These data indicate that the following function for 1/Q has been
-        // modeled in the MOS 8580:
-        //
-        // 1/Q = 2^(1/2)*2^(-x/8) = 2^(1/2 - x/8) = 2^((4 - x)/8)
-        for (int n8 = 0; n8 < 16; n8++) {
-          int x = mf.ak;
-          for (int vi = 0; vi < (1 << 16); vi++) {
-            mf.resonance[n8][vi] = solve_gain_d(opamp, resGain[n8], vi, x, mf);
-          }
+      // In the MOS 8580, the resonance "resistor" ladder above the bp feedback
+      // op-amp is split in two parts; one ladder for the op-amp input and one
+      // ladder for the op-amp feedback.
+      //
+      // input:         feedback:
+      //
+      //             Rf
+      // Ri R4 RC R8    R3
+      //             R2
+      //             R1
+      //
+      //
+      // The "resistors" are switched in as follows by bits in register $17:
+      //
+      // feedback:
+      // R1: bit4&!bit5
+      // R2: !bit4&bit5
+      // R3: bit4&bit5
+      // Rf: always on
+      //
+      // input:
+      // R4: bit6&!bit7
+      // R8: !bit6&bit7
+      // RC: bit6&bit7
+      // Ri: !(R4|R8|RC) = !(bit6|bit7) = !bit6&!bit7
+      //
+      //
+      // The relative "resistor" values are approximately (using channel length):
+      //
+      // R1 = 15.3*Ri
+      // R2 =  7.3*Ri
+      // R3 =  4.7*Ri
+      // Rf =  1.4*Ri
+      // R4 =  1.4*Ri
+      // R8 =  2.0*Ri
+      // RC =  2.8*Ri
+      //
+      //
+      // Approximate values for 1/Q can now be found as follows (assuming an
+      // ideal op-amp):
+      //
+      // res  feedback  input  -gain (1/Q)
+      // ---  --------  -----  ----------
+      // 0   Rf        Ri     Rf/Ri      = 1/(Ri*(1/Rf))      = 1/0.71
+      // 1   Rf|R1     Ri     (Rf|R1)/Ri = 1/(Ri*(1/Rf+1/R1)) = 1/0.78
+      // 2   Rf|R2     Ri     (Rf|R2)/Ri = 1/(Ri*(1/Rf+1/R2)) = 1/0.85
+      // 3   Rf|R3     Ri     (Rf|R3)/Ri = 1/(Ri*(1/Rf+1/R3)) = 1/0.92
+      // 4   Rf        R4     Rf/R4      = 1/(R4*(1/Rf))      = 1/1.00
+      // 5   Rf|R1     R4     (Rf|R1)/R4 = 1/(R4*(1/Rf+1/R1)) = 1/1.10
+      // 6   Rf|R2     R4     (Rf|R2)/R4 = 1/(R4*(1/Rf+1/R2)) = 1/1.20
+      // 7   Rf|R3     R4     (Rf|R3)/R4 = 1/(R4*(1/Rf+1/R3)) = 1/1.30
+      // 8   Rf        R8     Rf/R8      = 1/(R8*(1/Rf))      = 1/1.43
+      // 9   Rf|R1     R8     (Rf|R1)/R8 = 1/(R8*(1/Rf+1/R1)) = 1/1.56
+      // A   Rf|R2     R8     (Rf|R2)/R8 = 1/(R8*(1/Rf+1/R2)) = 1/1.70
+      // B   Rf|R3     R8     (Rf|R3)/R8 = 1/(R8*(1/Rf+1/R3)) = 1/1.86
+      // C   Rf        RC     Rf/RC      = 1/(RC*(1/Rf))      = 1/2.00
+      // D   Rf|R1     RC     (Rf|R1)/RC = 1/(RC*(1/Rf+1/R1)) = 1/2.18
+      // E   Rf|R2     RC     (Rf|R2)/RC = 1/(RC*(1/Rf+1/R2)) = 1/2.38
+      // F   Rf|R3     RC     (Rf|R3)/RC = 1/(RC*(1/Rf+1/R3)) = 1/2.60
+      //
+      //
+      // These data indicate that the following function for 1/Q has been
+      // modeled in the MOS 8580:
+      //
+      // 1/Q = 2^(1/2)*2^(-x/8) = 2^(1/2 - x/8) = 2^((4 - x)/8)
+      for (int n8 = 0; n8 < 16; n8++) {
+        int x = mf.ak;
+        for (int vi = 0; vi < (1 << 16); vi++) {
+          mf.resonance[n8][vi] = solve_gain_d(opamp, resGain[n8], vi, x, mf);
         }
+      }
 
-        // scaled 5 bits
-        n_param = (int)(tmp_n_param[1] * 32 + 0.5);
-
-        double Vgt = (Vref * 1.6) - fi.Vth;
-        nVgt = (int)(N16 * (Vgt - vmin) + 0.5);
-
-        // DAC table.
-        // W/L ratio for frequency DAC, bits are proportional.
-        // scaled 5 bits
-        unsigned int dacWL = 806; // 0,00307464599609375 * 1024 * 256 (actual value is ~= 0.003075)
-        mf.f0_dac[0] = dacWL >> 8;
-        for (int n = 1; n < (1 << dac_bits); n++) {
-          // Calculate W/L ratio for parallel NMOS resistances
-          unsigned int wl = 0;
-          for (unsigned int i = 0; i < dac_bits; i++) {
-            unsigned int bitmask = 1 << i;
-            if (n & bitmask) {
-                wl += dacWL * (bitmask<<1);
-            }
+      // scaled 5 bits
+      n_param = (int)(tmp_n_param * 32 + 0.5);
+
+      // DAC table.
+      // W/L ratio for frequency DAC, bits are proportional.
+      // scaled 5 bits
+      unsigned int dacWL = 806; // 0,00307464599609375 * 1024 * 256 (actual value is ~= 0.003075)
+      mf.f0_dac[0] = dacWL >> 8;
+      for (int n = 1; n < (1 << dac_bits); n++) {
+        // Calculate W/L ratio for parallel NMOS resistances
+        unsigned int wl = 0;
+        for (unsigned int i = 0; i < dac_bits; i++) {
+          unsigned int bitmask = 1 << i;
+          if (n & bitmask) {
+              wl += dacWL * (bitmask<<1);
           }
-          mf.f0_dac[n] = wl >> 8;
         }
+        mf.f0_dac[n] = wl >> 8;
       }
     }
+  }
+
+  // Free temporary tables.
+  delete[] voltages;
+  delete[] opamp;
+
+  materialized[model] = true;
+}
+#else
+// Tables generated at build time reside in shared read-only data;
+// there is nothing to materialize.
+void Filter::materialize_tables(int)
+{
+}
+#endif // !RESID_PREBUILT_FILTER_TABLES
 
-    // Free temporary tables.
-    delete[] voltages;
-    delete[] opamp;
 
-    class_init = true;
+// ----------------------------------------------------------------------------
+// Constructor.
+// ----------------------------------------------------------------------------
+Filter::Filter()
+{
+  // Per instance parameters, previously initialized as a side effect of
+  // the static table computation. set_chip_model below re-derives the
+  // cutoff parameters from fc.
+  {
+    model_filter_init_t& fi = model_filter_init[1];
+    double Vgt = (Vref * 1.6) - fi.Vth;
+    double vmin = fi.opamp_voltage[0][0];
+    Vw_bias = 0;
+    fc = 0;
+    res = 0;
+    nVgt = (int)(vo_N16_scalar(1) * (Vgt - vmin) + 0.5);
   }
 
+  fast_filter = false;
+
   enable_filter(true);
   set_chip_model(MOS6581);
   set_voice_mask(0x07);
@@ -629,6 +686,103 @@ Filter::Filter()
 }
 
 
+// ----------------------------------------------------------------------------
+// Fast filter mode support tables.
+//
+// Approximate FC -> cutoff frequency mapping, interpolated from measured
+// data points and converted to the fixed point w0 representation used by
+// clock_fast.
+// ----------------------------------------------------------------------------
+typedef double fc_point[2];
+
+static const fc_point f0_points_6581[] =
+{
+  //  FC      f         FCHI FCLO
+  // ----------------------------
+  {    0,   220 },   // 0x00      - repeated end point
+  {    0,   220 },   // 0x00
+  {  128,   230 },   // 0x10
+  {  256,   250 },   // 0x20
+  {  384,   300 },   // 0x30
+  {  512,   420 },   // 0x40
+  {  640,   780 },   // 0x50
+  {  768,  1600 },   // 0x60
+  {  832,  2300 },   // 0x68
+  {  896,  3200 },   // 0x70
+  {  960,  4300 },   // 0x78
+  {  992,  5000 },   // 0x7c
+  { 1008,  5400 },   // 0x7e
+  { 1016,  5700 },   // 0x7f
+  { 1023,  6000 },   // 0x7f 0x07
+  { 1023,  6000 },   // 0x7f 0x07 - discontinuity
+  { 1024,  4600 },   // 0x80      -
+  { 1024,  4600 },   // 0x80
+  { 1032,  4800 },   // 0x81
+  { 1056,  5300 },   // 0x84
+  { 1088,  6000 },   // 0x88
+  { 1120,  6600 },   // 0x8c
+  { 1152,  7200 },   // 0x90
+  { 1280,  9500 },   // 0xa0
+  { 1408, 12000 },   // 0xb0
+  { 1536, 14500 },   // 0xc0
+  { 1664, 16000 },   // 0xd0
+  { 1792, 17100 },   // 0xe0
+  { 1920, 17700 },   // 0xf0
+  { 2047, 18000 },   // 0xff 0x07
+  { 2047, 18000 }    // 0xff 0x07 - repeated end point
+};
+
+static const fc_point f0_points_8580[] =
+{
+  //  FC      f         FCHI FCLO
+  // ----------------------------
+  {    0,     0 },   // 0x00      - repeated end point
+  {    0,     0 },   // 0x00
+  {  128,   800 },   // 0x10
+  {  256,  1600 },   // 0x20
+  {  384,  2500 },   // 0x30
+  {  512,  3300 },   // 0x40
+  {  640,  4100 },   // 0x50
+  {  768,  4800 },   // 0x60
+  {  896,  5600 },   // 0x70
+  { 1024,  6500 },   // 0x80
+  { 1152,  7500 },   // 0x90
+  { 1280,  8400 },   // 0xa0
+  { 1408,  9200 },   // 0xb0
+  { 1536,  9800 },   // 0xc0
+  { 1664, 10500 },   // 0xd0
+  { 1792, 11000 },   // 0xe0
+  { 1920, 11700 },   // 0xf0
+  { 2047, 12500 },   // 0xff 0x07
+  { 2047, 12500 }    // 0xff 0x07 - repeated end point
+};
+
+int Filter::w0_fast[2][1 << 11];
+
+bool Filter::fast_class_init_tables()
+{
+  interpolate(f0_points_6581,
+              f0_points_6581
+              + sizeof(f0_points_6581)/sizeof(*f0_points_6581) - 1,
+              PointPlotter<int>(w0_fast[0]), 1.0);
+  interpolate(f0_points_8580,
+              f0_points_8580
+              + sizeof(f0_points_8580)/sizeof(*f0_points_8580) - 1,
+              PointPlotter<int>(w0_fast[1]), 1.0);
+
+  // Convert f0 to w0 = 2*pi*f0, scaled by 2^20/1e6 per cycle.
+  for (int m = 0; m < 2; m++) {
+    for (int i = 0; i < (1 << 11); i++) {
+      w0_fast[m][i] = int(2*3.1415926535897932385*w0_fast[m][i]*1.048576);
+    }
+  }
+
+  return true;
+}
+
+bool Filter::fast_class_init = Filter::fast_class_init_tables();
+
+
 // ----------------------------------------------------------------------------
 // Enable filter.
 // ----------------------------------------------------------------------------
@@ -639,6 +793,21 @@ void Filter::enable_filter(bool enable)
 }
 
 
+// ----------------------------------------------------------------------------
+// Select the fast filter mode.
+// ----------------------------------------------------------------------------
+void Filter::enable_fast_filter(bool enable)
+{
+  fast_filter = enable;
+
+  // The two modes use different state variable scaling; restart from
+  // silence.
+  Vhp = 0;
+  Vbp = Vbp_x = Vbp_vc = 0;
+  Vlp = Vlp_x = Vlp_vc = 0;
+}
+
+
 // ----------------------------------------------------------------------------
 // Adjust the DAC bias parameter of the filter.
 // This gives user variable control of the exact CF -> center frequency
@@ -646,7 +815,7 @@ void Filter::enable_filter(bool enable)
 // ----------------------------------------------------------------------------
 void Filter::adjust_filter_bias(double dac_bias)
 {
-  Vw_bias = int(dac_bias*model_filter[0].vo_N16);
+  Vw_bias = int(dac_bias*vo_N16_scalar(0));
   set_w0();
 
   // Gate voltage is controlled by the switched capacitor voltage divider
@@ -658,7 +827,7 @@ void Filter::adjust_filter_bias(double dac_bias)
 
   // Vg - Vth, normalized so that translated values can be subtracted:
   // Vgt - x = (Vgt - t) - (x - t)
-  nVgt = (int)(model_filter[1].vo_N16 * (Vgt - vmin) + 0.5);
+  nVgt = (int)(vo_N16_scalar(1) * (Vgt - vmin) + 0.5);
 }
 
 // ----------------------------------------------------------------------------
@@ -667,6 +836,10 @@ void Filter::adjust_filter_bias(double dac_bias)
 void Filter::set_chip_model(chip_model model)
 {
   sid_model = model;
+  materialize_tables(model);
+  // The cutoff parameters computed on the last FC register write refer
+  // to the previous model; re-derive them for the new one.
+  set_w0();
   /* We initialize the state variables again just to make sure that
    * the earlier model didn't leave behind some foreign, unrecoverable
    * state. Hopefully set_chip_model() only occurs simultaneously with
@@ -700,6 +873,8 @@ void Filter::reset()
   mode = 0;
   vol = 0;
 
+  q_1024_div = int(1024.0/0.707);
+
   Vhp = 0;
   Vbp = Vbp_x = Vbp_vc = 0;
   Vlp = Vlp_x = Vlp_vc = 0;
@@ -728,6 +903,9 @@ void Filter::writeRES_FILT(reg8 res_filt)
 {
   res = (res_filt >> 4) & 0x0f;
 
+  // Fast mode resonance; 1/Q is controlled linearly by res.
+  q_1024_div = int(1024.0/(0.707 + 1.0*res/0x0f));
+
   filt = res_filt & 0x0f;
   set_sum_mix();
 }
@@ -743,14 +921,15 @@ void Filter::writeMODE_VOL(reg8 mode_vol)
 // Set filter cutoff frequency.
 void Filter::set_w0()
 {
-  {
+  // Only the tables of the selected model are materialized; the other
+  // model's parameters are re-derived by set_chip_model.
+  if (sid_model == 0) {
     // MOS 6581
     model_filter_t& f = model_filter[0];
     int Vw = Vw_bias + f.f0_dac[fc];
     Vddt_Vw_2 = unsigned(f.kVddt - Vw)*unsigned(f.kVddt - Vw) >> 1;
   }
-
-  {
+  else {
     // MOS 8580 cutoff: 0 - 12.5kHz.
     model_filter_t& f = model_filter[1];
     n_dac = (n_param * f.f0_dac[fc]) >> 15;
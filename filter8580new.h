@@ -528,12 +528,16 @@ public:
   Filter();
 
   void enable_filter(bool enable);
+  // Select the fast filter mode, see clock_fast below.
+  void enable_fast_filter(bool enable);
   void adjust_filter_bias(double dac_bias);
   void set_chip_model(chip_model model);
   void set_voice_mask(reg4 mask);
 
   void clock(int voice1, int voice2, int voice3);
   void clock(cycle_count delta_t, int voice1, int voice2, int voice3);
+  // Clock the voice input stage only, see below.
+  void clock_bypass(int voice1, int voice2, int voice3);
   void reset();
 
   // Write registers.
@@ -552,9 +556,22 @@ protected:
   void set_sum_mix();
   void set_w0();
 
+  void clock_fast(cycle_count delta_t, int voice1, int voice2, int voice3);
+  short output_fast();
+
   // Filter enabled.
   bool enabled;
 
+  // Fast filter mode enabled.
+  bool fast_filter;
+  // Fast mode resonance, 1024/Q.
+  int q_1024_div;
+  // Fast mode FC -> w0 mapping; w0 = 2*pi*f0, scaled by 2^20/1e6 per
+  // cycle. Interpolated from measured cutoff data points.
+  static int w0_fast[2][1 << 11];
+  static bool fast_class_init_tables();
+  static bool fast_class_init;
+
   // Filter cutoff frequency.
   reg12 fc;
 
@@ -634,7 +651,8 @@ protected:
   int nVgt;
 
   //int solve_gain(opamp_t* opamp, int n, int vi_t, int& x, model_filter_t& mf);
-  int solve_gain_d(opamp_t* opamp, double n, int vi_t, int& x, model_filter_t& mf);
+  // Static since it is also called from the one-time table initialization.
+  static int solve_gain_d(opamp_t* opamp, double n, int vi_t, int& x, model_filter_t& mf);
   int solve_integrate_6581(int dt, int vi_t, int& x, int& vc, model_filter_t& mf);
   int solve_integrate_8580(int dt, int vi_t, int& x, int& vc, model_filter_t& mf);
 
@@ -644,7 +662,15 @@ protected:
   // Common parameters.
   static model_filter_t model_filter[2];
 
+  // Lazy one-time materialization of the per model static tables above,
+  // triggered by set_chip_model; only the chip models actually selected
+  // pay their memory footprint. See filter8580new.cc. A no-op when the
+  // tables are generated at build time.
+  static void materialize_tables(int model);
+
 friend class SID;
+// Build time table generator, see genfilttables.cc.
+friend class FilterTableGenerator;
 };
 
 
@@ -662,6 +688,11 @@ friend class SID;
 RESID_INLINE
 void Filter::clock(int voice1, int voice2, int voice3)
 {
+  if (unlikely(fast_filter)) {
+    clock_fast(1, voice1, voice2, voice3);
+    return;
+  }
+
   model_filter_t& f = model_filter[sid_model];
 
   v1 = (voice1*f.voice_scale_s14 >> 18) + f.voice_DC;
@@ -754,12 +785,43 @@ void Filter::clock(int voice1, int voice2, int voice3)
   }
 }
 
+// ----------------------------------------------------------------------------
+// SID clocking - 1 cycle, filter disabled.
+// Clocks the voice input stage only, so that output() keeps mixing the
+// current voice inputs, without spending cycles on the integrators. NB!
+// Re-enabling the filter mid-stream thus continues from the integrator
+// state left at disable time; enable_filter is intended for
+// configuration, not for modulation.
+// ----------------------------------------------------------------------------
+RESID_INLINE
+void Filter::clock_bypass(int voice1, int voice2, int voice3)
+{
+  if (unlikely(fast_filter)) {
+    // The fast filter mode mixes the raw voice outputs.
+    v1 = voice1;
+    v2 = voice2;
+    v3 = voice3;
+    return;
+  }
+
+  model_filter_t& f = model_filter[sid_model];
+
+  v1 = (voice1*f.voice_scale_s14 >> 18) + f.voice_DC;
+  v2 = (voice2*f.voice_scale_s14 >> 18) + f.voice_DC;
+  v3 = (voice3*f.voice_scale_s14 >> 18) + f.voice_DC;
+}
+
 // ----------------------------------------------------------------------------
 // SID clocking - delta_t cycles.
 // ----------------------------------------------------------------------------
 RESID_INLINE
 void Filter::clock(cycle_count delta_t, int voice1, int voice2, int voice3)
 {
+  if (unlikely(fast_filter)) {
+    clock_fast(delta_t, voice1, voice2, voice3);
+    return;
+  }
+
   model_filter_t& f = model_filter[sid_model];
 
   v1 = (voice1*f.voice_scale_s14 >> 18) + f.voice_DC;
@@ -882,6 +944,135 @@ void Filter::clock(cycle_count delta_t, int voice1, int voice2, int voice3)
 }
 
 
+// ----------------------------------------------------------------------------
+// Fast filter mode - direct form state variable filter.
+//
+// The table driven filter model above scatters its lookups across
+// several megabytes of gain and op-amp tables; on small cores the cache
+// misses cost more than arithmetic would. The fast mode instead
+// computes a two integrator loop state variable filter directly in
+// fixed point, with cutoff interpolated from measured FC -> f0 data
+// points and 1/Q derived linearly from res:
+//
+//   Vhp = Vbp/Q - Vlp - Vi
+//   dVbp = -w0*Vhp*dt
+//   dVlp = -w0*Vbp*dt
+//
+// The working set is the 8KB w0 table for the selected model. The
+// frequency response tracks the table driven model within a couple of
+// dB; distortion and op-amp saturation are not modeled.
+//
+// The voice inputs are used at their full 20 bit scale, reusing the
+// Vhp/Vbp/Vlp state variables (the integrator ladder state Vbp_x etc.
+// is unused in this mode).
+// ----------------------------------------------------------------------------
+RESID_INLINE
+void Filter::clock_fast(cycle_count delta_t, int voice1, int voice2, int voice3)
+{
+  v1 = voice1;
+  v2 = voice2;
+  v3 = voice3;
+
+  if (unlikely(!enabled)) {
+    return;
+  }
+
+  // Sum inputs routed into the filter.
+  int Vi = 0;
+  if (sum & 0x1) {
+    Vi += v1;
+  }
+  if (sum & 0x2) {
+    Vi += v2;
+  }
+  if (sum & 0x4) {
+    Vi += v3;
+  }
+  if (sum & 0x8) {
+    // Rescale the external input from the table driven representation.
+    Vi += (ve - model_filter[sid_model].mixer[0]) << 4;
+  }
+
+  int w0 = w0_fast[sid_model][fc];
+
+  if (delta_t == 1) {
+    // Limit f0 to 16kHz for stability of the single cycle update.
+    const int w0_max_1 = 105414;  // 2*pi*16000*1.048576
+    int w0_ceil = w0 <= w0_max_1 ? w0 : w0_max_1;
+
+    Vbp -= int(((long long)w0_ceil*Vhp) >> 20);
+    Vlp -= int(((long long)w0_ceil*Vbp) >> 20);
+    Vhp = int(((long long)Vbp*q_1024_div) >> 10) - Vlp - Vi;
+    return;
+  }
+
+  // Limit f0 to 4kHz for stability of the eight cycle update.
+  const int w0_max_dt = 26353;  // 2*pi*4000*1.048576
+  int w0_ceil_dt = w0 <= w0_max_dt ? w0 : w0_max_dt;
+
+  // Maximum delta cycles for the filter to work satisfactorily under
+  // current cutoff frequency and resonance constraints is approximately 8.
+  cycle_count delta_t_flt = 8;
+
+  while (delta_t) {
+    if (unlikely(delta_t < delta_t_flt)) {
+      delta_t_flt = delta_t;
+    }
+
+    int w0_delta_t = w0_ceil_dt*(int)delta_t_flt;
+
+    Vbp -= int(((long long)w0_delta_t*Vhp) >> 20);
+    Vlp -= int(((long long)w0_delta_t*Vbp) >> 20);
+    Vhp = int(((long long)Vbp*q_1024_div) >> 10) - Vlp - Vi;
+
+    delta_t -= delta_t_flt;
+  }
+}
+
+
+// ----------------------------------------------------------------------------
+// Fast filter mode audio output.
+// ----------------------------------------------------------------------------
+RESID_INLINE
+short Filter::output_fast()
+{
+  // Sum inputs routed into the mixer.
+  int Vi = 0;
+  if (mix & 0x01) {
+    Vi += v1;
+  }
+  if (mix & 0x02) {
+    Vi += v2;
+  }
+  if (mix & 0x04) {
+    Vi += v3;
+  }
+  if (mix & 0x08) {
+    Vi += (ve - model_filter[sid_model].mixer[0]) << 4;
+  }
+  if (mix & 0x10) {
+    Vi += Vlp;
+  }
+  if (mix & 0x20) {
+    Vi += Vbp;
+  }
+  if (mix & 0x40) {
+    Vi += Vhp;
+  }
+
+  // Scale the 20 bit voice range down to 16 bits and apply the master
+  // volume. Resonance peaks may overshoot; saturate.
+  int Vo = int(((long long)Vi*vol) >> 11);
+  if (Vo > 32767) {
+    Vo = 32767;
+  }
+  else if (Vo < -32768) {
+    Vo = -32768;
+  }
+  return (short)Vo;
+}
+
+
 // ----------------------------------------------------------------------------
 // SID audio input (16 bits).
 // ----------------------------------------------------------------------------
@@ -908,6 +1099,10 @@ void Filter::input(short sample)
 RESID_INLINE
 short Filter::output()
 {
+  if (unlikely(fast_filter)) {
+    return output_fast();
+  }
+
   model_filter_t& f = model_filter[sid_model];
 
   // Writing the switch below manually would be tedious and error-prone;
@@ -0,0 +1,149 @@
+//  ---------------------------------------------------------------------------
+//  This file is part of reSID, a MOS6581 SID emulator engine.
+//  Copyright (C) 2010  Dag Lem <resid@nimrod.no>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//  ---------------------------------------------------------------------------
+
+// Build time generator for the filter op-amp and gain tables.
+//
+// The Filter constructor computes roughly 9MB of lookup tables per chip
+// model by spline interpolation and op-amp solving at static-init time,
+// burning startup latency and dirtying private pages in every process.
+// When configured with --enable-prebuilt-filter-tables, this tool is
+// compiled against the normal run time table computation, runs it once on
+// the build host, and emits filter_tables.h with the fully initialized
+// table definitions. The library is then compiled with
+// RESID_PREBUILT_FILTER_TABLES, placing the tables in shared read-only
+// data and skipping the computation entirely.
+//
+// NB! The tool runs on the build host and is thus not suitable for
+// cross compilation.
+
+#include "resid-config.h"
+#if NEW_8580_FILTER
+#include "filter8580new.h"
+#else
+#include "filter.h"
+#endif
+
+#include <stdio.h>
+
+namespace reSID
+{
+
+class FilterTableGenerator
+{
+public:
+  static int dump(FILE* f);
+};
+
+static void put_array(FILE* f, const unsigned short* data, long n)
+{
+  fprintf(f, "{");
+  for (long i = 0; i < n; i++) {
+    fprintf(f, "%s0x%x,", (i % 12) ? "" : "\n", data[i]);
+  }
+  fprintf(f, "\n}");
+}
+
+int FilterTableGenerator::dump(FILE* f)
+{
+  // Trigger the normal run time table computation for both chip models.
+  Filter::materialize_tables(0);
+  Filter::materialize_tables(1);
+
+  fprintf(f,
+          "// Generated by genfilttables - do not edit.\n"
+          "// Prebuilt filter tables, included by the filter implementation\n"
+          "// when configured with --enable-prebuilt-filter-tables.\n\n");
+
+  fprintf(f, "Filter::model_filter_t Filter::model_filter[2] = {\n");
+  for (int m = 0; m < 2; m++) {
+    const Filter::model_filter_t& mf = Filter::model_filter[m];
+    fprintf(f, "{\n");
+#if NEW_8580_FILTER
+    fprintf(f, "%d,%d,%d,%d,%d,%d,%d,\n%.17g,\n",
+            mf.kVddt, mf.voice_scale_s14, mf.voice_DC, mf.ak, mf.bk,
+            mf.vc_min, mf.vc_max, mf.vo_N16);
+#else
+    fprintf(f, "%d,%d,%d,%d,%d,%d,%d,%d,%d,\n",
+            mf.vo_N16, mf.kVddt, mf.n_snake, mf.voice_scale_s14,
+            mf.voice_DC, mf.ak, mf.bk, mf.vc_min, mf.vc_max);
+#endif
+    put_array(f, mf.opamp_rev, 1L << 16);
+    fprintf(f, ",\n");
+    put_array(f, mf.summer, summer_offset<5>::value);
+    fprintf(f, ",\n{");
+    for (int i = 0; i < 16; i++) {
+      put_array(f, mf.gain[i], 1L << 16);
+      fprintf(f, ",");
+    }
+    fprintf(f, "},\n");
+#if NEW_8580_FILTER
+    fprintf(f, "{");
+    for (int i = 0; i < 16; i++) {
+      put_array(f, mf.resonance[i], 1L << 16);
+      fprintf(f, ",");
+    }
+    fprintf(f, "},\n");
+#endif
+    put_array(f, mf.mixer, mixer_offset<8>::value);
+    fprintf(f, ",\n");
+    put_array(f, mf.f0_dac, 1L << 11);
+    fprintf(f, "\n},\n");
+  }
+  fprintf(f, "};\n\n");
+
+  fprintf(f, "unsigned short Filter::vcr_kVg[1 << 16] = ");
+  put_array(f, Filter::vcr_kVg, 1L << 16);
+  fprintf(f, ";\n\n");
+
+  fprintf(f, "unsigned short Filter::vcr_n_Ids_term[1 << 16] = ");
+  put_array(f, Filter::vcr_n_Ids_term, 1L << 16);
+  fprintf(f, ";\n");
+
+#if NEW_8580_FILTER
+  fprintf(f, "\nint Filter::n_snake = %d;\n", Filter::n_snake);
+  fprintf(f, "int Filter::n_param = %d;\n", Filter::n_param);
+#endif
+
+  return 0;
+}
+
+} // namespace reSID
+
+int main(int argc, char** argv)
+{
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <output file>\n", argv[0]);
+    return 1;
+  }
+
+  FILE* f = fopen(argv[1], "w");
+  if (!f) {
+    fprintf(stderr, "%s: failed to open %s for writing\n", argv[0], argv[1]);
+    return 1;
+  }
+
+  int res = reSID::FilterTableGenerator::dump(f);
+
+  if (fclose(f) != 0) {
+    fprintf(stderr, "%s: failed to write %s\n", argv[0], argv[1]);
+    return 1;
+  }
+
+  return res;
+}
@@ -0,0 +1,257 @@
+//  ---------------------------------------------------------------------------
+//  This file is part of reSID, a MOS6581 SID emulator engine.
+//  Copyright (C) 2010  Dag Lem <resid@nimrod.no>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//  ---------------------------------------------------------------------------
+
+#include "renderer.h"
+
+#include <thread>
+
+namespace reSID
+{
+
+// ----------------------------------------------------------------------------
+// Constructor.
+// ----------------------------------------------------------------------------
+TuneRenderer::TuneRenderer()
+{
+  model = MOS6581;
+  clock_frequency = 985248;
+  sampling = SAMPLE_FAST;
+  sample_frequency = 44100;
+  // One PAL screen refresh.
+  cycles_per_frame = 19656;
+  // 25 frames is half a second of PAL video, far beyond the settling time
+  // of the external filter.
+  snapshot_interval = 25;
+}
+
+
+// ----------------------------------------------------------------------------
+// Rendering parameters.
+// ----------------------------------------------------------------------------
+void TuneRenderer::set_chip_model(chip_model model)
+{
+  this->model = model;
+}
+
+bool TuneRenderer::set_sampling_parameters(double clock_freq,
+                                           sampling_method method,
+                                           double sample_freq)
+{
+  // Validate the parameters on a scratch SID instance.
+  SID sid;
+  if (!sid.set_sampling_parameters(clock_freq, method, sample_freq)) {
+    return false;
+  }
+
+  clock_frequency = clock_freq;
+  sampling = method;
+  sample_frequency = sample_freq;
+  return true;
+}
+
+void TuneRenderer::set_cycles_per_frame(cycle_count cycles)
+{
+  cycles_per_frame = cycles;
+}
+
+void TuneRenderer::set_snapshot_interval(int frames)
+{
+  if (frames < 1) {
+    frames = 1;
+  }
+  snapshot_interval = frames;
+}
+
+
+// ----------------------------------------------------------------------------
+// Render a range of frames on one SID instance, appending samples to buf.
+// Returns the number of samples produced.
+// ----------------------------------------------------------------------------
+static int render_frames(SID& sid, TuneRenderer::frame_callback play,
+                         void* userdata, int frame_start, int frame_end,
+                         cycle_count cycles_per_frame,
+                         short* buf, int bufsize)
+{
+  int s = 0;
+
+  for (int f = frame_start; f < frame_end; f++) {
+    play(sid, f, userdata);
+
+    cycle_count delta_t = cycles_per_frame;
+    while (delta_t) {
+      if (s >= bufsize) {
+        // Buffer full; keep clocking so the chip state stays correct.
+        short scratch[256];
+        sid.clock(delta_t, scratch, 256);
+        continue;
+      }
+      s += sid.clock(delta_t, buf + s, bufsize - s);
+    }
+  }
+
+  return s;
+}
+
+
+// ----------------------------------------------------------------------------
+// One parallel rendering job: a contiguous range of frames with its own
+// SID instance and output buffer.
+// ----------------------------------------------------------------------------
+struct render_job
+{
+  TuneRenderer::frame_callback play;
+  void* userdata;
+  const SID::State* state;
+  int frame_start;
+  int frame_end;
+  chip_model model;
+  double clock_frequency;
+  sampling_method sampling;
+  double sample_frequency;
+  cycle_count cycles_per_frame;
+  short* buf;
+  int bufsize;
+  int produced;
+};
+
+static void render_job_run(render_job* job)
+{
+  SID sid;
+  sid.set_chip_model(job->model);
+  sid.set_sampling_parameters(job->clock_frequency, job->sampling,
+                              job->sample_frequency);
+  sid.write_state(*job->state);
+
+  job->produced = render_frames(sid, job->play, job->userdata,
+                                job->frame_start, job->frame_end,
+                                job->cycles_per_frame,
+                                job->buf, job->bufsize);
+}
+
+
+// ----------------------------------------------------------------------------
+// Two-pass parallel rendering.
+// ----------------------------------------------------------------------------
+int TuneRenderer::render(frame_callback play, void* userdata, int frames,
+                         short* buf, int bufsize, int threads)
+{
+  if (frames <= 0 || bufsize <= 0) {
+    return 0;
+  }
+
+  if (threads <= 0) {
+    threads = std::thread::hardware_concurrency();
+    if (threads <= 0) {
+      threads = 1;
+    }
+  }
+
+  // Thread ranges are aligned to snapshot boundaries; there is no point
+  // in more threads than snapshot intervals.
+  int n_snapshots = (frames + snapshot_interval - 1)/snapshot_interval;
+  if (threads > n_snapshots) {
+    threads = n_snapshots;
+  }
+
+  if (threads == 1) {
+    // Plain serial rendering.
+    SID sid;
+    sid.set_chip_model(model);
+    sid.set_sampling_parameters(clock_frequency, sampling, sample_frequency);
+    return render_frames(sid, play, userdata, 0, frames, cycles_per_frame,
+                         buf, bufsize);
+  }
+
+  // Logging pass: run the tune once, snapshotting the chip state at each
+  // snapshot interval. The configured sampling method is used (with the
+  // audio discarded) so that register writes are timed exactly as in the
+  // parallel pass.
+  SID::State* snapshots = new SID::State[n_snapshots];
+  {
+    SID sid;
+    sid.set_chip_model(model);
+    sid.set_sampling_parameters(clock_frequency, sampling, sample_frequency);
+
+    short scratch[4096];
+    for (int f = 0; f < frames; f++) {
+      if (f % snapshot_interval == 0) {
+        snapshots[f/snapshot_interval] = sid.read_state();
+      }
+      play(sid, f, userdata);
+      cycle_count delta_t = cycles_per_frame;
+      while (delta_t) {
+        sid.clock(delta_t, scratch, 4096);
+      }
+    }
+  }
+
+  // Parallel pass: render contiguous frame ranges concurrently, each
+  // starting from its snapshot.
+  render_job* jobs = new render_job[threads];
+  std::thread* workers = new std::thread[threads];
+
+  // An upper bound on the samples produced per frame.
+  double samples_per_frame =
+    cycles_per_frame*sample_frequency/clock_frequency + 1;
+
+  int intervals_per_job = n_snapshots/threads;
+  int intervals_extra = n_snapshots % threads;
+  int frame = 0;
+
+  for (int i = 0; i < threads; i++) {
+    int n_intervals = intervals_per_job + (i < intervals_extra ? 1 : 0);
+    render_job& job = jobs[i];
+    job.play = play;
+    job.userdata = userdata;
+    job.frame_start = frame;
+    frame += n_intervals*snapshot_interval;
+    job.frame_end = frame < frames ? frame : frames;
+    job.state = &snapshots[job.frame_start/snapshot_interval];
+    job.model = model;
+    job.clock_frequency = clock_frequency;
+    job.sampling = sampling;
+    job.sample_frequency = sample_frequency;
+    job.cycles_per_frame = cycles_per_frame;
+    job.bufsize =
+      int((job.frame_end - job.frame_start)*samples_per_frame) + 16;
+    job.buf = new short[job.bufsize];
+    job.produced = 0;
+
+    workers[i] = std::thread(render_job_run, &job);
+  }
+
+  // Concatenate the ranges in order.
+  int s = 0;
+  for (int i = 0; i < threads; i++) {
+    workers[i].join();
+    render_job& job = jobs[i];
+    for (int j = 0; j < job.produced && s < bufsize; j++) {
+      buf[s++] = job.buf[j];
+    }
+    delete[] job.buf;
+  }
+
+  delete[] workers;
+  delete[] jobs;
+  delete[] snapshots;
+
+  return s;
+}
+
+} // namespace reSID
@@ -0,0 +1,86 @@
+//  ---------------------------------------------------------------------------
+//  This file is part of reSID, a MOS6581 SID emulator engine.
+//  Copyright (C) 2010  Dag Lem <resid@nimrod.no>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//  ---------------------------------------------------------------------------
+
+#ifndef RESID_RENDERER_H
+#define RESID_RENDERER_H
+
+#include "resid-config.h"
+#include "sid.h"
+
+namespace reSID
+{
+
+// ----------------------------------------------------------------------------
+// Offline, faster than realtime tune rendering.
+//
+// Rendering a tune is normally strictly serial, since the emulation state
+// lives in a single SID instance. TuneRenderer splits the work in two
+// passes: a state logging pass which runs the tune once on one SID and
+// snapshots the chip state via SID::read_state at regular frame
+// intervals, and a parallel pass which restores the snapshots into
+// per-thread SID instances and renders contiguous frame ranges
+// concurrently, concatenating the audio in order.
+//
+// SID::State is a complete snapshot including the filter, external
+// filter and resampler state, so the stitched output is bit-identical
+// to a serial render.
+//
+// The frame callback must be deterministic - it is called once per frame
+// in the logging pass and again in the parallel pass - and must perform
+// the same register writes for a given frame number each time. Writes
+// may be issued with sid.queue_write() for exact intra-frame timing.
+// ----------------------------------------------------------------------------
+class TuneRenderer
+{
+public:
+  // Callback driving the tune; performs the register writes for one
+  // frame, e.g. by replaying a register dump or by running a player
+  // routine.
+  typedef void (*frame_callback)(SID& sid, int frame, void* userdata);
+
+  TuneRenderer();
+
+  void set_chip_model(chip_model model);
+  bool set_sampling_parameters(double clock_freq, sampling_method method,
+  double sample_freq);
+  // Cycles per frame callback, e.g. one PAL screen refresh.
+  void set_cycles_per_frame(cycle_count cycles);
+  // Frames between state snapshots in the logging pass. Thread ranges
+  // are aligned to snapshot boundaries.
+  void set_snapshot_interval(int frames);
+
+  // Render the given number of frames into buf, using up to the
+  // specified number of threads (0 selects the number of hardware
+  // threads). Returns the number of samples written; output is
+  // truncated if bufsize is too small.
+  int render(frame_callback play, void* userdata, int frames,
+  short* buf, int bufsize, int threads = 0);
+
+protected:
+  chip_model model;
+  double clock_frequency;
+  sampling_method sampling;
+  double sample_frequency;
+  cycle_count cycles_per_frame;
+  int snapshot_interval;
+};
+
+} // namespace reSID
+
+#endif // not RESID_RENDERER_H
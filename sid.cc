@@ -26,15 +26,97 @@
 
 #include "sid.h"
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 
 #include <iostream>
 #include <fstream>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 using namespace std;
 
+#if defined(HAVE_MMAP)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// On x86 with GCC or Clang the convolution kernels are compiled at
+// several ISA levels within the one binary, using the target attribute,
+// and selected at runtime with __builtin_cpu_supports. One library
+// binary then runs at full speed from SSE2 era machines to AVX2
+// servers. Other compilers and architectures fall back to selecting one
+// kernel at compile time from the predefined ISA macros.
+#if RESID_SIMD && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define RESID_CPU_DISPATCH 1
+#endif
+
+// SIMD intrinsics for the resampling convolution kernels.
+#if RESID_CPU_DISPATCH
+#include <immintrin.h>
+#elif RESID_SIMD
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+#endif
+
+// Compile hot loops at several ISA levels, resolved via ifunc at load
+// time. Used for the per-cycle voice loop in SID::clock_block, where the
+// compiler vectorizes the envelope and waveform passes.
+#if RESID_CPU_DISPATCH && defined(__ELF__)
+#define RESID_TARGET_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define RESID_TARGET_CLONES
+#endif
+
 #ifndef round
 #define round(x) (x>=0.0?floor(x+0.5):ceil(x-0.5))
 #endif
 
+// Hot path instrumentation, compiled in with --enable-profile. The
+// PROFILE macros bracket the subsystem stages of the batched clocking
+// paths, accumulating into SID::profile_counters; when RESID_PROFILE is
+// off they expand to nothing, making the counters literally free.
+#if RESID_PROFILE
+#include <time.h>
+
+static inline unsigned long long profile_tick()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((unsigned long long)hi << 32) | lo;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+#define PROFILE_TICK(t) unsigned long long t = profile_tick()
+// Accumulate the time since t into a counter and restart t, so that
+// consecutive stages can share one timestamp chain.
+#define PROFILE_ACCUM(counter, t) \
+  do { \
+    unsigned long long profile_t_now = profile_tick(); \
+    profile_counters.counter += profile_t_now - t; \
+    t = profile_t_now; \
+  } while (0)
+#define PROFILE_COUNT(counter, n) (profile_counters.counter += (n))
+#else
+#define PROFILE_TICK(t)
+#define PROFILE_ACCUM(counter, t)
+#define PROFILE_COUNT(counter, n)
+#endif
+
 namespace reSID
 {
 
@@ -55,6 +137,544 @@ inline short amplify(int input, int scaleFactor)
     return clip((scaleFactor * input) / 2);
 }
 
+// ----------------------------------------------------------------------------
+// Buffer allocation for the sample rings and the FIR tables. By default
+// the buffers come from operator new[]; SID::set_allocator redirects them
+// to caller provided memory, e.g. a hugepage backed or NUMA local arena.
+// ----------------------------------------------------------------------------
+static void* (*buffer_alloc_func)(size_t size, void* user) = 0;
+static void (*buffer_free_func)(void* ptr, void* user) = 0;
+static void* buffer_alloc_user = 0;
+
+static short* buffer_alloc(size_t count)
+{
+  if (buffer_alloc_func) {
+    return (short*)buffer_alloc_func(count*sizeof(short), buffer_alloc_user);
+  }
+  return new short[count];
+}
+
+static void buffer_free(short* ptr)
+{
+  if (!ptr) {
+    return;
+  }
+  if (buffer_free_func) {
+    buffer_free_func(ptr, buffer_alloc_user);
+    return;
+  }
+  delete[] ptr;
+}
+
+// ----------------------------------------------------------------------------
+// Inner product of two 16-bit vectors, accumulated into 32 bits.
+// This is the hot loop of the resampling code; with the FIR table sizes
+// computed in set_sampling_parameters the convolutions may run to several
+// hundred taps per output sample. SIMD variants are provided for SSE2/AVX2
+// and NEON, with a scalar fallback for other targets.
+// Note that no alignment is assumed; the ring buffer is walked at arbitrary
+// sample offsets.
+// ----------------------------------------------------------------------------
+#if RESID_CPU_DISPATCH
+
+__attribute__((target("avx2")))
+static int fir_convolve_avx2(const short* sample, const short* fir, int n)
+{
+  __m256i acc = _mm256_setzero_si256();
+  int j = 0;
+  for (; j <= n - 16; j += 16) {
+    __m256i s = _mm256_loadu_si256((const __m256i*)(sample + j));
+    __m256i f = _mm256_loadu_si256((const __m256i*)(fir + j));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(s, f));
+  }
+  // Horizontal sum of the eight 32-bit lanes.
+  __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                              _mm256_extracti128_si256(acc, 1));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+  int v = _mm_cvtsi128_si32(sum);
+  for (; j < n; j++) {
+    v += sample[j]*fir[j];
+  }
+  return v;
+}
+
+__attribute__((target("sse2")))
+static int fir_convolve_sse2(const short* sample, const short* fir, int n)
+{
+  __m128i acc = _mm_setzero_si128();
+  int j = 0;
+  for (; j <= n - 8; j += 8) {
+    __m128i s = _mm_loadu_si128((const __m128i*)(sample + j));
+    __m128i f = _mm_loadu_si128((const __m128i*)(fir + j));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(s, f));
+  }
+  // Horizontal sum of the four 32-bit lanes.
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4e));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xb1));
+  int v = _mm_cvtsi128_si32(acc);
+  for (; j < n; j++) {
+    v += sample[j]*fir[j];
+  }
+  return v;
+}
+
+static int fir_convolve_scalar(const short* sample, const short* fir, int n)
+{
+  int v = 0;
+  for (int j = 0; j < n; j++) {
+    v += sample[j]*fir[j];
+  }
+  return v;
+}
+
+typedef int (*fir_convolve_fn)(const short* sample, const short* fir, int n);
+
+static fir_convolve_fn select_fir_convolve()
+{
+  if (__builtin_cpu_supports("avx2")) {
+    return fir_convolve_avx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return fir_convolve_sse2;
+  }
+  return fir_convolve_scalar;
+}
+
+// The kernel is selected once before main; all SID instances share it.
+static const fir_convolve_fn fir_convolve_ptr = select_fir_convolve();
+
+inline int fir_convolve(const short* sample, const short* fir, int n)
+{
+  return fir_convolve_ptr(sample, fir, n);
+}
+
+#elif RESID_SIMD && defined(__AVX2__)
+
+inline int fir_convolve(const short* sample, const short* fir, int n)
+{
+  __m256i acc = _mm256_setzero_si256();
+  int j = 0;
+  for (; j <= n - 16; j += 16) {
+    __m256i s = _mm256_loadu_si256((const __m256i*)(sample + j));
+    __m256i f = _mm256_loadu_si256((const __m256i*)(fir + j));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(s, f));
+  }
+  // Horizontal sum of the eight 32-bit lanes.
+  __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                              _mm256_extracti128_si256(acc, 1));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+  int v = _mm_cvtsi128_si32(sum);
+  for (; j < n; j++) {
+    v += sample[j]*fir[j];
+  }
+  return v;
+}
+
+#elif RESID_SIMD && (defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(_M_X64))
+
+inline int fir_convolve(const short* sample, const short* fir, int n)
+{
+  __m128i acc = _mm_setzero_si128();
+  int j = 0;
+  for (; j <= n - 8; j += 8) {
+    __m128i s = _mm_loadu_si128((const __m128i*)(sample + j));
+    __m128i f = _mm_loadu_si128((const __m128i*)(fir + j));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(s, f));
+  }
+  // Horizontal sum of the four 32-bit lanes.
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4e));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xb1));
+  int v = _mm_cvtsi128_si32(acc);
+  for (; j < n; j++) {
+    v += sample[j]*fir[j];
+  }
+  return v;
+}
+
+#elif RESID_SIMD && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+
+inline int fir_convolve(const short* sample, const short* fir, int n)
+{
+  int32x4_t acc = vdupq_n_s32(0);
+  int j = 0;
+  for (; j <= n - 8; j += 8) {
+    int16x8_t s = vld1q_s16(sample + j);
+    int16x8_t f = vld1q_s16(fir + j);
+    acc = vmlal_s16(acc, vget_low_s16(s), vget_low_s16(f));
+    acc = vmlal_s16(acc, vget_high_s16(s), vget_high_s16(f));
+  }
+#if defined(__aarch64__)
+  int v = vaddvq_s32(acc);
+#else
+  int32x2_t sum = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+  sum = vpadd_s32(sum, sum);
+  int v = vget_lane_s32(sum, 0);
+#endif
+  for (; j < n; j++) {
+    v += sample[j]*fir[j];
+  }
+  return v;
+}
+
+#else
+
+inline int fir_convolve(const short* sample, const short* fir, int n)
+{
+  int v = 0;
+  for (int j = 0; j < n; j++) {
+    v += sample[j]*fir[j];
+  }
+  return v;
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Shared FIR tables.
+//
+// The Kaiser windowed sinc tables computed in set_sampling_parameters are
+// pure functions of the sampling parameters, yet for SAMPLE_RESAMPLE_FASTMEM
+// they amount to tens of megabytes of double precision math per SID
+// construction. The tables are immutable once computed, so they are kept in
+// a process-wide refcounted cache; SID instances with identical sampling
+// parameters (e.g. the two or three chips of a stereo or triple SID
+// configuration) share one physical copy instead of each recomputing and
+// holding its own.
+//
+// In addition, a persistent on-disk cache can be enabled with
+// set_fir_cache_dir(). Computed tables are then serialized to binary files
+// keyed by the table parameters, and are memory mapped read-only on
+// subsequent runs, which also makes separate processes with identical
+// sampling parameters share one physical copy of the table.
+//
+// The cache files are host specific (endianness, type sizes); they are
+// validated by an exact header match and are simply recomputed on mismatch.
+// ----------------------------------------------------------------------------
+
+struct fir_cache_header
+{
+  char magic[8];
+  unsigned int version;
+  unsigned int fir_N;
+  unsigned int fir_RES;
+  double beta;
+  double f_cycles_per_sample;
+  double filter_scale;
+};
+
+struct fir_table_entry
+{
+  fir_cache_header key;
+
+  short* data;
+
+  // Set if data points into a read-only file mapping instead of heap
+  // memory allocated with new[].
+  void* mapping;
+  size_t mapping_size;
+
+  int refcount;
+  fir_table_entry* next;
+};
+
+// Linked list of live tables; the number of distinct sampling parameter
+// sets in one process is expected to be very small.
+static fir_table_entry* fir_tables = 0;
+static mutex fir_tables_mutex;
+
+static const char fir_cache_magic[8] =
+  { 'r', 'e', 'S', 'I', 'D', 'f', 'i', 'r' };
+static const unsigned int fir_cache_version = 1;
+
+static char fir_cache_dir[4096] = { 0 };
+
+void SID::set_fir_cache_dir(const char* path)
+{
+  if (!path) {
+    fir_cache_dir[0] = 0;
+    return;
+  }
+  strncpy(fir_cache_dir, path, sizeof(fir_cache_dir) - 1);
+  fir_cache_dir[sizeof(fir_cache_dir) - 1] = 0;
+}
+
+// ----------------------------------------------------------------------------
+// Set the allocation hooks used by buffer_alloc/buffer_free above.
+// ----------------------------------------------------------------------------
+void SID::set_allocator(void* (*alloc)(size_t size, void* user),
+                        void (*dealloc)(void* ptr, void* user),
+                        void* user)
+{
+  buffer_alloc_func = alloc;
+  buffer_free_func = dealloc;
+  buffer_alloc_user = user;
+}
+
+// ----------------------------------------------------------------------------
+// Upper bound on the bytes allocated per SID instance: the sample ring
+// and the stage 1 ring with their overflow copies, plus the stage 1 FIR,
+// which the ring overfill check in set_sampling_parameters bounds by the
+// stage 1 ring size.
+// ----------------------------------------------------------------------------
+size_t SID::instance_buffer_bytes()
+{
+  return (RINGSIZE*2 + STAGE1_RINGSIZE*2 + STAGE1_RINGSIZE)*sizeof(short);
+}
+
+// ----------------------------------------------------------------------------
+// Size of the FIR table shared by all instances with identical sampling
+// parameters; zero when no resampling method is selected.
+// ----------------------------------------------------------------------------
+size_t SID::fir_table_bytes() const
+{
+  return fir ? size_t(fir_N)*fir_RES*sizeof(short) : 0;
+}
+
+// Build cache file path from an FNV-1a hash of the header key.
+static void fir_cache_path(const fir_cache_header& header,
+                           char* path, size_t path_size)
+{
+  unsigned long long h = 14695981039346656037ULL;
+  const unsigned char* p = (const unsigned char*)&header;
+  for (size_t i = 0; i < sizeof(header); i++) {
+    h = (h ^ p[i])*1099511628211ULL;
+  }
+  sprintf(path, "%.*s/resid-fir-%016llx.dat",
+          (int)(path_size - 40), fir_cache_dir, h);
+}
+
+// ----------------------------------------------------------------------------
+// Try to satisfy a FIR table from the cache directory.
+// Returns true and sets entry->data on success.
+// ----------------------------------------------------------------------------
+static bool fir_cache_load(fir_table_entry* entry)
+{
+  if (!fir_cache_dir[0]) {
+    return false;
+  }
+
+  char path[4096];
+  fir_cache_path(entry->key, path, sizeof(path));
+
+  size_t table_size =
+    size_t(entry->key.fir_N)*entry->key.fir_RES*sizeof(short);
+
+#if defined(HAVE_MMAP)
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0
+      || size_t(st.st_size) != sizeof(fir_cache_header) + table_size) {
+    close(fd);
+    return false;
+  }
+
+  void* base = mmap(0, sizeof(fir_cache_header) + table_size, PROT_READ,
+                    MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    return false;
+  }
+
+  if (memcmp(base, &entry->key, sizeof(fir_cache_header)) != 0) {
+    munmap(base, sizeof(fir_cache_header) + table_size);
+    return false;
+  }
+
+  entry->mapping = base;
+  entry->mapping_size = sizeof(fir_cache_header) + table_size;
+  entry->data = (short*)((char*)base + sizeof(fir_cache_header));
+  return true;
+#else
+  // No mmap; fall back to reading the table into heap memory. This still
+  // avoids the table recomputation, but the pages are private.
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    return false;
+  }
+
+  fir_cache_header file_header;
+  if (fread(&file_header, sizeof(file_header), 1, f) != 1
+      || memcmp(&file_header, &entry->key, sizeof(file_header)) != 0) {
+    fclose(f);
+    return false;
+  }
+
+  entry->data = buffer_alloc(size_t(entry->key.fir_N)*entry->key.fir_RES);
+  if (fread(entry->data, 1, table_size, f) != table_size) {
+    fclose(f);
+    buffer_free(entry->data);
+    entry->data = 0;
+    return false;
+  }
+  fclose(f);
+  return true;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// Serialize a computed FIR table to the cache directory.
+// The file is written to a temporary name and renamed into place, so
+// concurrent processes racing on the same parameters are harmless.
+// ----------------------------------------------------------------------------
+static void fir_cache_store(const fir_table_entry* entry)
+{
+  if (!fir_cache_dir[0]) {
+    return;
+  }
+
+  char path[4096];
+  fir_cache_path(entry->key, path, sizeof(path));
+
+  char tmp_path[4200];
+  sprintf(tmp_path, "%s.tmp%lu", path, (unsigned long)
+#if defined(HAVE_MMAP)
+          getpid()
+#else
+          0
+#endif
+          );
+
+  FILE* f = fopen(tmp_path, "wb");
+  if (!f) {
+    return;
+  }
+
+  size_t table_size =
+    size_t(entry->key.fir_N)*entry->key.fir_RES*sizeof(short);
+  if (fwrite(&entry->key, sizeof(entry->key), 1, f) != 1
+      || fwrite(entry->data, 1, table_size, f) != table_size) {
+    fclose(f);
+    remove(tmp_path);
+    return;
+  }
+  fclose(f);
+
+  if (rename(tmp_path, path) != 0) {
+    remove(tmp_path);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Look up or create a shared FIR table for the given parameters.
+// The returned table is refcounted; every successful call must be paired
+// with a call to release_fir_table.
+// ----------------------------------------------------------------------------
+fir_table_entry* SID::acquire_fir_table(int fir_N, int fir_RES, double beta,
+                                        double f_cycles_per_sample,
+                                        double filter_scale)
+{
+  fir_cache_header key;
+  memset(&key, 0, sizeof(key));
+  memcpy(key.magic, fir_cache_magic, sizeof(key.magic));
+  key.version = fir_cache_version;
+  key.fir_N = fir_N;
+  key.fir_RES = fir_RES;
+  key.beta = beta;
+  key.f_cycles_per_sample = f_cycles_per_sample;
+  key.filter_scale = filter_scale;
+
+  lock_guard<mutex> lock(fir_tables_mutex);
+
+  for (fir_table_entry* entry = fir_tables; entry; entry = entry->next) {
+    if (memcmp(&entry->key, &key, sizeof(key)) == 0) {
+      entry->refcount++;
+      return entry;
+    }
+  }
+
+  fir_table_entry* entry = new fir_table_entry;
+  entry->key = key;
+  entry->data = 0;
+  entry->mapping = 0;
+  entry->mapping_size = 0;
+  entry->refcount = 1;
+
+  if (!fir_cache_load(entry)) {
+    entry->data = buffer_alloc(size_t(fir_N)*fir_RES);
+
+    const double pi = 3.1415926535897932385;
+
+    // The cutoff frequency is midway through the transition band (nyquist)
+    double wc = pi;
+    double I0beta = I0(beta);
+    double f_samples_per_cycle = 1.0/f_cycles_per_sample;
+
+    // Calculate fir_RES FIR tables for linear interpolation.
+    for (int i = 0; i < fir_RES; i++) {
+      int fir_offset = i*fir_N + fir_N/2;
+      double j_offset = double(i)/fir_RES;
+      // Calculate FIR table. This is the sinc function, weighted by the
+      // Kaiser window.
+      for (int j = -fir_N/2; j <= fir_N/2; j++) {
+        double jx = j - j_offset;
+        double wt = wc*jx/f_cycles_per_sample;
+        double temp = jx/(fir_N/2);
+        double Kaiser =
+          fabs(temp) <= 1 ? I0(beta*sqrt(1 - temp*temp))/I0beta : 0;
+        double sincwt = fabs(wt) >= 1e-6 ? sin(wt)/wt : 1;
+        double val =
+          (1 << FIR_SHIFT)*filter_scale*f_samples_per_cycle*wc/pi*sincwt*Kaiser;
+        entry->data[fir_offset + j] = (short)round(val);
+      }
+    }
+
+    fir_cache_store(entry);
+  }
+
+  entry->next = fir_tables;
+  fir_tables = entry;
+  return entry;
+}
+
+// ----------------------------------------------------------------------------
+// Drop a reference to a shared FIR table, freeing it on last release.
+// ----------------------------------------------------------------------------
+void SID::release_fir_table(fir_table_entry* entry)
+{
+  lock_guard<mutex> lock(fir_tables_mutex);
+
+  if (--entry->refcount > 0) {
+    return;
+  }
+
+  for (fir_table_entry** prev = &fir_tables; *prev; prev = &(*prev)->next) {
+    if (*prev == entry) {
+      *prev = entry->next;
+      break;
+    }
+  }
+
+#if defined(HAVE_MMAP)
+  if (entry->mapping) {
+    munmap(entry->mapping, entry->mapping_size);
+  }
+  else
+#endif
+  {
+    buffer_free(entry->data);
+  }
+  delete entry;
+}
+
+// ----------------------------------------------------------------------------
+// Drop this instance's FIR table reference.
+// ----------------------------------------------------------------------------
+void SID::release_fir()
+{
+  if (fir_handle) {
+    release_fir_table(fir_handle);
+    fir_handle = 0;
+  }
+  fir = 0;
+}
+
+
 // ----------------------------------------------------------------------------
 // Constructor.
 // ----------------------------------------------------------------------------
@@ -63,12 +683,35 @@ SID::SID()
   // Initialize pointers.
   sample = 0;
   fir = 0;
+  fir_handle = 0;
   fir_N = 0;
   fir_RES = 0;
   fir_beta = 0;
   fir_f_cycles_per_sample = 0;
   fir_filter_scale = 0;
 
+  decimate = 0;
+  decimate_index = 0;
+  stage1_N = 0;
+  stage1_fir = 0;
+  stage1_sample = 0;
+  stage1_index = 0;
+
+  ramp_target = 0;
+  ramp_remaining = 0;
+
+  dither_enabled = false;
+  dither_state = 1;
+
+  pipeline = 0;
+  pipe_avail = 0;
+  pipe_total = 0;
+  pipe_consumed = 0;
+  pipe_buf = 0;
+  pipe_n = 0;
+  pipe_s = 0;
+  pipe_interleave = 1;
+
   sid_model = MOS6581;
   voice[0].set_sync_source(&voice[2]);
   voice[1].set_sync_source(&voice[0]);
@@ -80,10 +723,19 @@ SID::SID()
   bus_value_ttl = 0;
   write_pipeline = 0;
 
+  write_queue_head = 0;
+  write_queue_tail = 0;
+  write_queue_end = 0;
+
   databus_ttl = 0;
 
   scaleFactor = 3;
 
+  tap_buf[0] = tap_buf[1] = tap_buf[2] = 0;
+  tap_interleave = 1;
+
+  reset_profile();
+
   raw_debug_output = false;
 }
 
@@ -93,8 +745,11 @@ SID::SID()
 // ----------------------------------------------------------------------------
 SID::~SID()
 {
-  delete[] sample;
-  delete[] fir;
+  enable_pipeline(false);
+  buffer_free(sample);
+  buffer_free(stage1_fir);
+  buffer_free(stage1_sample);
+  release_fir();
 }
 
 
@@ -140,6 +795,10 @@ void SID::reset()
 
   bus_value = 0;
   bus_value_ttl = 0;
+
+  write_queue_head = 0;
+  write_queue_tail = 0;
+  write_queue_end = 0;
 }
 
 
@@ -219,6 +878,36 @@ void SID::write(reg8 offset, reg8 value)
 }
 
 
+// ----------------------------------------------------------------------------
+// Queue a register write to be applied after the specified number of
+// cycles, counted from the current chip time. The queued events are
+// consumed at their exact cycle positions by
+// clock(delta_t, buf, n, interleave).
+// ----------------------------------------------------------------------------
+bool SID::queue_write(cycle_count delay, reg8 offset, reg8 value)
+{
+  int next_tail = (write_queue_tail + 1) & WRITE_QUEUE_MASK;
+  if (unlikely(next_tail == write_queue_head)) {
+    // Queue full; the chip must be clocked to drain the queue.
+    return false;
+  }
+
+  if (unlikely(delay < write_queue_end)) {
+    // Events are applied in queue order; defer until the previously
+    // queued event.
+    delay = write_queue_end;
+  }
+
+  write_event& e = write_queue[write_queue_tail];
+  e.offset = delay - write_queue_end;
+  e.address = offset;
+  e.value = value;
+  write_queue_end = delay;
+  write_queue_tail = next_tail;
+  return true;
+}
+
+
 // ----------------------------------------------------------------------------
 // Write registers.
 // ----------------------------------------------------------------------------
@@ -342,6 +1031,50 @@ SID::State::State()
     envelope_state[i] = EnvelopeGenerator::RELEASE;
     hold_zero[i] = true;
     envelope_pipeline[i] = 0;
+
+    msb_rising[i] = false;
+    waveform_output[i] = 0;
+    osc3[i] = 0;
+    tri_saw_pipeline[i] = 0x555;
+    noise_output[i] = 0;
+
+    exponential_pipeline[i] = 0;
+    state_pipeline[i] = 0;
+    new_exponential_counter_period[i] = 0;
+    envelope_next_state[i] = EnvelopeGenerator::RELEASE;
+    reset_rate_counter[i] = false;
+    env3[i] = 0;
+  }
+
+  Vhp = 0;
+  Vbp = 0;
+  Vbp_x = 0;
+  Vbp_vc = 0;
+  Vlp = 0;
+  Vlp_x = 0;
+  Vlp_vc = 0;
+  filter_ve = 0;
+  filter_v1 = 0;
+  filter_v2 = 0;
+  filter_v3 = 0;
+
+  extfilt_Vlp = 0;
+  extfilt_Vhp = 0;
+
+  sample_offset = 0;
+  sample_index = 0;
+  sample_prev = 0;
+  sample_now = 0;
+  sample_prev2 = 0;
+  sample_prev3 = 0;
+  for (i = 0; i < RINGSIZE*2; i++) {
+    sample[i] = 0;
+  }
+
+  decimate_index = 0;
+  stage1_index = 0;
+  for (i = 0; i < STAGE1_RINGSIZE*2; i++) {
+    stage1_sample[i] = 0;
   }
 }
 
@@ -406,6 +1139,57 @@ SID::State SID::read_state()
     state.envelope_state[i] = voice[i].envelope.state;
     state.hold_zero[i] = voice[i].envelope.hold_zero;
     state.envelope_pipeline[i] = voice[i].envelope.envelope_pipeline;
+
+    state.msb_rising[i] = voice[i].wave.msb_rising;
+    state.waveform_output[i] = voice[i].wave.waveform_output;
+    state.osc3[i] = voice[i].wave.osc3;
+    state.tri_saw_pipeline[i] = voice[i].wave.tri_saw_pipeline;
+    state.noise_output[i] = voice[i].wave.noise_output;
+
+    state.exponential_pipeline[i] = voice[i].envelope.exponential_pipeline;
+    state.state_pipeline[i] = voice[i].envelope.state_pipeline;
+    state.new_exponential_counter_period[i] =
+      voice[i].envelope.new_exponential_counter_period;
+    state.envelope_next_state[i] = voice[i].envelope.next_state;
+    state.reset_rate_counter[i] = voice[i].envelope.reset_rate_counter;
+    state.env3[i] = voice[i].envelope.env3;
+  }
+
+  state.Vhp = filter.Vhp;
+  state.Vbp = filter.Vbp;
+  state.Vbp_x = filter.Vbp_x;
+  state.Vbp_vc = filter.Vbp_vc;
+  state.Vlp = filter.Vlp;
+  state.Vlp_x = filter.Vlp_x;
+  state.Vlp_vc = filter.Vlp_vc;
+  state.filter_ve = filter.ve;
+  state.filter_v1 = filter.v1;
+  state.filter_v2 = filter.v2;
+  state.filter_v3 = filter.v3;
+
+  state.extfilt_Vlp = extfilt.Vlp;
+  state.extfilt_Vhp = extfilt.Vhp;
+
+  state.sample_offset = sample_offset;
+  state.sample_index = sample_index;
+  state.sample_prev = sample_prev;
+  state.sample_now = sample_now;
+  state.sample_prev2 = sample_prev2;
+  state.sample_prev3 = sample_prev3;
+  if (sample) {
+    memcpy(state.sample, sample, RINGSIZE*2*sizeof(short));
+  }
+  else {
+    memset(state.sample, 0, RINGSIZE*2*sizeof(short));
+  }
+
+  state.decimate_index = decimate_index;
+  state.stage1_index = stage1_index;
+  if (stage1_sample) {
+    memcpy(state.stage1_sample, stage1_sample, STAGE1_RINGSIZE*2*sizeof(short));
+  }
+  else {
+    memset(state.stage1_sample, 0, STAGE1_RINGSIZE*2*sizeof(short));
   }
 
   return state;
@@ -453,18 +1237,346 @@ void SID::write_state(const State& state)
     voice[i].envelope.state = state.envelope_state[i];
     voice[i].envelope.hold_zero = state.hold_zero[i];
     voice[i].envelope.envelope_pipeline = state.envelope_pipeline[i];
+
+    voice[i].wave.msb_rising = state.msb_rising[i];
+    voice[i].wave.waveform_output = state.waveform_output[i];
+    voice[i].wave.osc3 = state.osc3[i];
+    voice[i].wave.tri_saw_pipeline = state.tri_saw_pipeline[i];
+    voice[i].wave.noise_output = state.noise_output[i];
+    // no_noise is rebuilt by the register replay above.
+    voice[i].wave.no_noise_or_noise_output =
+      voice[i].wave.no_noise | voice[i].wave.noise_output;
+
+    voice[i].envelope.exponential_pipeline = state.exponential_pipeline[i];
+    voice[i].envelope.state_pipeline = state.state_pipeline[i];
+    voice[i].envelope.new_exponential_counter_period =
+      state.new_exponential_counter_period[i];
+    voice[i].envelope.next_state = state.envelope_next_state[i];
+    voice[i].envelope.reset_rate_counter = state.reset_rate_counter[i];
+    voice[i].envelope.env3 = state.env3[i];
+  }
+
+  filter.Vhp = state.Vhp;
+  filter.Vbp = state.Vbp;
+  filter.Vbp_x = state.Vbp_x;
+  filter.Vbp_vc = state.Vbp_vc;
+  filter.Vlp = state.Vlp;
+  filter.Vlp_x = state.Vlp_x;
+  filter.Vlp_vc = state.Vlp_vc;
+  filter.ve = state.filter_ve;
+  filter.v1 = state.filter_v1;
+  filter.v2 = state.filter_v2;
+  filter.v3 = state.filter_v3;
+
+  extfilt.Vlp = state.extfilt_Vlp;
+  extfilt.Vhp = state.extfilt_Vhp;
+
+  sample_offset = state.sample_offset;
+  sample_index = state.sample_index;
+  sample_prev = state.sample_prev;
+  sample_now = state.sample_now;
+  sample_prev2 = state.sample_prev2;
+  sample_prev3 = state.sample_prev3;
+  if (sample) {
+    memcpy(sample, state.sample, RINGSIZE*2*sizeof(short));
+  }
+
+  decimate_index = state.decimate_index;
+  stage1_index = state.stage1_index;
+  if (stage1_sample) {
+    memcpy(stage1_sample, state.stage1_sample, STAGE1_RINGSIZE*2*sizeof(short));
   }
 }
 
 
 // ----------------------------------------------------------------------------
-// Mask for voices routed into the filter / audio output stage.
-// Used to physically connect/disconnect EXT IN, and for test purposed
-// (voice muting).
+// Checkpoint index for constant time seeking, see sid.h.
 // ----------------------------------------------------------------------------
-void SID::set_voice_mask(reg4 mask)
+
+// Serialization header; the format is host and build specific like the
+// FIR table cache files, validated by an exact magic/version/size match.
+struct checkpoint_index_header
 {
-  filter.set_voice_mask(mask);
+  char magic[8];
+  unsigned int version;
+  unsigned int checkpoint_size;
+  long long interval;
+  long long cycle;
+  long long next_checkpoint;
+  int n_checkpoints;
+  int n_writes;
+};
+
+static const char checkpoint_index_magic[8] =
+  { 'r', 'e', 'S', 'I', 'D', 'i', 'd', 'x' };
+static const unsigned int checkpoint_index_version = 1;
+
+SIDCheckpointIndex::SIDCheckpointIndex(cycle_count interval)
+{
+  checkpoint_interval = interval >= 1 ? interval : 1;
+  cycle = 0;
+  next_checkpoint = checkpoint_interval;
+  checkpoint_list = 0;
+  n_checkpoints = 0;
+  checkpoint_capacity = 0;
+  write_log = 0;
+  n_writes = 0;
+  write_capacity = 0;
+}
+
+SIDCheckpointIndex::~SIDCheckpointIndex()
+{
+  for (int i = 0; i < n_checkpoints; i++) {
+    delete checkpoint_list[i];
+  }
+  delete[] checkpoint_list;
+  delete[] write_log;
+}
+
+// ----------------------------------------------------------------------------
+// Snapshot the chip at the current position.
+// ----------------------------------------------------------------------------
+void SIDCheckpointIndex::record_checkpoint(SID& sid)
+{
+  if (n_checkpoints == checkpoint_capacity) {
+    int capacity = checkpoint_capacity ? 2*checkpoint_capacity : 16;
+    Checkpoint** list = new Checkpoint*[capacity];
+    if (n_checkpoints) {
+      memcpy(list, checkpoint_list, n_checkpoints*sizeof(Checkpoint*));
+    }
+    delete[] checkpoint_list;
+    checkpoint_list = list;
+    checkpoint_capacity = capacity;
+  }
+
+  Checkpoint* checkpoint = new Checkpoint;
+  checkpoint->cycle = cycle;
+  checkpoint->state = sid.read_state();
+  checkpoint_list[n_checkpoints++] = checkpoint;
+}
+
+// ----------------------------------------------------------------------------
+// Forward a register write to the chip, logging it for replay. The
+// initial checkpoint is recorded first, so that it precedes any write at
+// position zero.
+// ----------------------------------------------------------------------------
+void SIDCheckpointIndex::write(SID& sid, reg8 offset, reg8 value)
+{
+  if (unlikely(!n_checkpoints)) {
+    record_checkpoint(sid);
+  }
+
+  if (n_writes == write_capacity) {
+    int capacity = write_capacity ? 2*write_capacity : 1024;
+    WriteRecord* log = new WriteRecord[capacity];
+    if (n_writes) {
+      memcpy(log, write_log, n_writes*sizeof(WriteRecord));
+    }
+    delete[] write_log;
+    write_log = log;
+    write_capacity = capacity;
+  }
+
+  WriteRecord& record = write_log[n_writes++];
+  record.cycle = cycle;
+  record.offset = offset;
+  record.value = value;
+
+  sid.write(offset, value);
+}
+
+// ----------------------------------------------------------------------------
+// Report a batch of clocked cycles. Checkpoints are recorded when the
+// position passes an interval boundary; since the batch has already been
+// clocked, the snapshot lands at most one batch past the boundary, at its
+// exact recorded position.
+// ----------------------------------------------------------------------------
+void SIDCheckpointIndex::advance(SID& sid, cycle_count delta_t)
+{
+  if (delta_t <= 0) {
+    return;
+  }
+
+  if (unlikely(!n_checkpoints)) {
+    record_checkpoint(sid);
+  }
+
+  cycle += delta_t;
+
+  if (cycle >= next_checkpoint) {
+    record_checkpoint(sid);
+    next_checkpoint = cycle + checkpoint_interval;
+  }
+}
+
+long long SIDCheckpointIndex::position() const
+{
+  return cycle;
+}
+
+int SIDCheckpointIndex::checkpoints() const
+{
+  return n_checkpoints;
+}
+
+// ----------------------------------------------------------------------------
+// Re-emulate from a restored checkpoint with the configured sampling
+// method, so that the resampler ring buffers track real playback; the
+// rendered samples are discarded.
+// ----------------------------------------------------------------------------
+void SIDCheckpointIndex::roll_forward(SID& sid, cycle_count delta_t)
+{
+  short buf[2048];
+  while (delta_t) {
+    sid.clock(delta_t, buf, 2048);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Restore the chip to the given position: restore the nearest checkpoint
+// at or before it, then re-emulate up to the position, replaying the
+// logged writes at their exact cycles. Writes logged at the target
+// position itself are applied.
+// ----------------------------------------------------------------------------
+long long SIDCheckpointIndex::seek(SID& sid, long long target)
+{
+  if (target < 0 || target > cycle || !n_checkpoints) {
+    return -1;
+  }
+
+  // Binary search for the last checkpoint at or before the target.
+  int lo = 0;
+  int hi = n_checkpoints - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1)/2;
+    if (checkpoint_list[mid]->cycle <= target) {
+      lo = mid;
+    }
+    else {
+      hi = mid - 1;
+    }
+  }
+  const Checkpoint* checkpoint = checkpoint_list[lo];
+
+  // Binary search for the first write at or after the checkpoint; writes
+  // logged at the checkpoint position follow its snapshot.
+  int w_lo = 0;
+  int w_hi = n_writes;
+  while (w_lo < w_hi) {
+    int mid = (w_lo + w_hi)/2;
+    if (write_log[mid].cycle < checkpoint->cycle) {
+      w_lo = mid + 1;
+    }
+    else {
+      w_hi = mid;
+    }
+  }
+
+  sid.write_state(checkpoint->state);
+
+  long long pos = checkpoint->cycle;
+  for (int w = w_lo; w < n_writes && write_log[w].cycle <= target; w++) {
+    roll_forward(sid, cycle_count(write_log[w].cycle - pos));
+    pos = write_log[w].cycle;
+    sid.write(write_log[w].offset, write_log[w].value);
+  }
+  roll_forward(sid, cycle_count(target - pos));
+
+  return target - checkpoint->cycle;
+}
+
+// ----------------------------------------------------------------------------
+// Serialization to/from a caller provided buffer.
+// ----------------------------------------------------------------------------
+size_t SIDCheckpointIndex::serialize_bytes() const
+{
+  return sizeof(checkpoint_index_header)
+    + size_t(n_checkpoints)*sizeof(Checkpoint)
+    + size_t(n_writes)*sizeof(WriteRecord);
+}
+
+void SIDCheckpointIndex::serialize(char* buf) const
+{
+  checkpoint_index_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, checkpoint_index_magic, sizeof(header.magic));
+  header.version = checkpoint_index_version;
+  header.checkpoint_size = sizeof(Checkpoint);
+  header.interval = checkpoint_interval;
+  header.cycle = cycle;
+  header.next_checkpoint = next_checkpoint;
+  header.n_checkpoints = n_checkpoints;
+  header.n_writes = n_writes;
+
+  memcpy(buf, &header, sizeof(header));
+  buf += sizeof(header);
+  for (int i = 0; i < n_checkpoints; i++) {
+    memcpy(buf, checkpoint_list[i], sizeof(Checkpoint));
+    buf += sizeof(Checkpoint);
+  }
+  if (n_writes) {
+    memcpy(buf, write_log, size_t(n_writes)*sizeof(WriteRecord));
+  }
+}
+
+SIDCheckpointIndex* SIDCheckpointIndex::deserialize(const char* buf,
+                                                    size_t size)
+{
+  checkpoint_index_header header;
+  if (size < sizeof(header)) {
+    return 0;
+  }
+  memcpy(&header, buf, sizeof(header));
+
+  if (memcmp(header.magic, checkpoint_index_magic, sizeof(header.magic)) != 0
+      || header.version != checkpoint_index_version
+      || header.checkpoint_size != sizeof(Checkpoint)
+      || header.n_checkpoints < 0 || header.n_writes < 0
+      || header.interval < 1
+      || size != sizeof(header)
+         + size_t(header.n_checkpoints)*sizeof(Checkpoint)
+         + size_t(header.n_writes)*sizeof(WriteRecord))
+  {
+    return 0;
+  }
+
+  SIDCheckpointIndex* index =
+    new SIDCheckpointIndex(cycle_count(header.interval));
+  index->cycle = header.cycle;
+  index->next_checkpoint = header.next_checkpoint;
+
+  buf += sizeof(header);
+  index->checkpoint_capacity =
+    header.n_checkpoints ? header.n_checkpoints : index->checkpoint_capacity;
+  if (header.n_checkpoints) {
+    index->checkpoint_list = new Checkpoint*[header.n_checkpoints];
+    for (int i = 0; i < header.n_checkpoints; i++) {
+      Checkpoint* checkpoint = new Checkpoint;
+      memcpy(checkpoint, buf, sizeof(Checkpoint));
+      index->checkpoint_list[i] = checkpoint;
+      buf += sizeof(Checkpoint);
+    }
+    index->n_checkpoints = header.n_checkpoints;
+  }
+  if (header.n_writes) {
+    index->write_log = new WriteRecord[header.n_writes];
+    memcpy(index->write_log, buf, size_t(header.n_writes)*sizeof(WriteRecord));
+    index->n_writes = header.n_writes;
+    index->write_capacity = header.n_writes;
+  }
+
+  return index;
+}
+
+
+// ----------------------------------------------------------------------------
+// Mask for voices routed into the filter / audio output stage.
+// Used to physically connect/disconnect EXT IN, and for test purposed
+// (voice muting).
+// ----------------------------------------------------------------------------
+void SID::set_voice_mask(reg4 mask)
+{
+  filter.set_voice_mask(mask);
 }
 
 
@@ -477,6 +1589,15 @@ void SID::enable_filter(bool enable)
 }
 
 
+// ----------------------------------------------------------------------------
+// Select the fast filter mode.
+// ----------------------------------------------------------------------------
+void SID::enable_fast_filter(bool enable)
+{
+  filter.enable_fast_filter(enable);
+}
+
+
 // ----------------------------------------------------------------------------
 // Adjust the DAC bias parameter of the filter.
 // This gives user variable control of the exact CF -> center frequency
@@ -497,18 +1618,120 @@ void SID::enable_external_filter(bool enable)
 }
 
 // ----------------------------------------------------------------------------
-// write raw output to a file
+// Enable TPDF dither of the resampled 16 bit output.
+//
+// The FIR accumulation of the resampling methods carries FIR_SHIFT bits
+// of extra precision which are truncated on output. With dither enabled,
+// triangular noise spanning one output LSB is added before truncation,
+// decorrelating the truncation error from the signal.
+// Dither does not apply to SAMPLE_FAST and SAMPLE_INTERPOLATE, where
+// samples are produced directly at 16 bits.
+// ----------------------------------------------------------------------------
+void SID::enable_dither(bool enable)
+{
+  dither_enabled = enable;
+}
+
+// ----------------------------------------------------------------------------
+// Write raw output to a file.
+//
+// The audio path only pushes each sample to a lock-free single
+// producer/single consumer ring buffer; a background thread drains the
+// ring and writes the samples to disk. This keeps the per-cycle cost
+// down to two atomic accesses and a store, so raw capture can be left
+// armed on live machines. If the writer thread cannot keep up, samples
+// are dropped (and counted) rather than blocking the audio path.
 // ----------------------------------------------------------------------------
+class DebugCapture
+{
+public:
+  DebugCapture()
+  {
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    done.store(false, std::memory_order_relaxed);
+    dropped = 0;
+    myFile.open("resid.raw", ios::out | ios::binary);
+    writer = std::thread(run, this);
+  }
+
+  ~DebugCapture()
+  {
+    done.store(true, std::memory_order_release);
+    writer.join();
+    if (dropped) {
+      std::cout << "reSID: dropped " << dropped << " capture samples."
+                << std::endl;
+    }
+  }
+
+  // Producer side, called from SID::clock.
+  void put(int n)
+  {
+    unsigned int h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= CAPTURE_RINGSIZE) {
+      dropped++;
+      return;
+    }
+    ring[h & CAPTURE_RINGMASK] = n;
+    head.store(h + 1, std::memory_order_release);
+  }
+
+protected:
+  // Consumer side; drains the ring to disk until told to stop.
+  static void run(DebugCapture* c)
+  {
+    char bytes[8192];
+
+    for (;;) {
+      unsigned int t = c->tail.load(std::memory_order_relaxed);
+      unsigned int h = c->head.load(std::memory_order_acquire);
+      if (t == h) {
+        if (c->done.load(std::memory_order_acquire)) {
+          break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
+      }
+
+      // Write 16 bit little endian signed data.
+      int b = 0;
+      while (t != h && b < (int)sizeof(bytes)) {
+        short n = c->ring[t++ & CAPTURE_RINGMASK];
+        bytes[b++] = n & 0xff;
+        bytes[b++] = (n >> 8) & 0xff;
+      }
+      c->myFile.write(bytes, b);
+      c->tail.store(t, std::memory_order_release);
+    }
+
+    c->myFile.close();
+  }
+
+  enum {
+    // One megasample of headroom, about a second of capture.
+    CAPTURE_RINGSIZE = 1 << 20,
+    CAPTURE_RINGMASK = CAPTURE_RINGSIZE - 1
+  };
+  short ring[CAPTURE_RINGSIZE];
+  std::atomic<unsigned int> head;
+  std::atomic<unsigned int> tail;
+  std::atomic<bool> done;
+  unsigned int dropped;
+  ofstream myFile;
+  std::thread writer;
+};
+
 void SID::debugoutput(void)
 {
     static int recording = -1;
-    static ofstream myFile;
+    /* the first call opens the file and starts the writer thread; the
+       thread is joined and the file flushed at process exit */
+    static DebugCapture capture;
     static int lastn;
     int n = filter.output();
     if (recording == -1) {
-        /* the first call opens the file */
         recording = 0;
-        myFile.open ("resid.raw", ios::out | ios::binary);
         lastn = n;
         std::cout << "reSID: waiting for output to change..." << std::endl;
     } else if ((recording == 0) && (lastn != n)) {
@@ -516,10 +1739,8 @@ void SID::debugoutput(void)
         recording = 1;
         std::cout << "reSID: starting recording..." << std::endl;
     }
-    /* write 16bit little endian signed data */
     if (recording) {
-        myFile.put(n & 0xff);
-        myFile.put((n >> 8) & 0xff);
+        capture.put(n);
     }
 }
 
@@ -534,6 +1755,200 @@ void SID::enable_raw_debug_output(bool enable)
     }
 }
 
+// ----------------------------------------------------------------------------
+// Worker thread state for pipelined clocking, see SID::enable_pipeline.
+//
+// The calling thread stages the per voice sample streams for a chunk of
+// cycles into one of two slots; the worker thread runs the filter stages
+// and the resampler of the previous chunk. The handoff is a lock-free
+// slot ring as in DebugCapture above; the mutex and condition variable
+// only park the worker while no clocking call is in progress.
+// ----------------------------------------------------------------------------
+class SIDPipeline
+{
+public:
+  enum {
+    // Cycles per handoff chunk: large enough that the handoff cost is
+    // negligible, small enough that the staged streams stay cache
+    // resident and the startup/drain serial fraction remains low.
+    CHUNK = 512,
+    SLOTS = 2,
+    SLOTMASK = SLOTS - 1
+  };
+
+  struct Slot
+  {
+    cycle_count n;
+    int vout[3][CHUNK];
+  };
+
+  SIDPipeline(SID* sid) : sid(sid)
+  {
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    stop.store(false, std::memory_order_relaxed);
+    worker = std::thread(run, this);
+  }
+
+  ~SIDPipeline()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m);
+      stop.store(true, std::memory_order_release);
+    }
+    cv.notify_one();
+    worker.join();
+  }
+
+  // Producer side: wait for a free slot to stage the next chunk into.
+  // At most SLOTS chunks are in flight, so the wait is bounded by the
+  // worker retiring one chunk.
+  Slot& acquire_slot()
+  {
+    unsigned int h = head.load(std::memory_order_relaxed);
+    while (h - tail.load(std::memory_order_acquire) >= SLOTS) {
+      std::this_thread::yield();
+    }
+    return slot[h & SLOTMASK];
+  }
+
+  // Producer side: hand the filled slot to the worker.
+  void submit()
+  {
+    head.store(head.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+    // Taking the mutex serializes against the worker's sleep check, so
+    // the wakeup cannot fall between its check and its wait.
+    {
+      std::lock_guard<std::mutex> lock(m);
+    }
+    cv.notify_one();
+  }
+
+  // Producer side: wait until all submitted chunks are complete.
+  void drain()
+  {
+    while (tail.load(std::memory_order_acquire)
+           != head.load(std::memory_order_relaxed)) {
+      std::this_thread::yield();
+    }
+  }
+
+protected:
+  static void run(SIDPipeline* p)
+  {
+    for (;;) {
+      unsigned int t = p->tail.load(std::memory_order_relaxed);
+      if (t == p->head.load(std::memory_order_acquire)) {
+        // Park until more work is submitted or the pipeline is torn
+        // down.
+        std::unique_lock<std::mutex> lock(p->m);
+        while (!p->stop.load(std::memory_order_acquire)
+               && t == p->head.load(std::memory_order_acquire)) {
+          p->cv.wait(lock);
+        }
+        if (t == p->head.load(std::memory_order_acquire)) {
+          break;
+        }
+        continue;
+      }
+
+      Slot& s = p->slot[t & SLOTMASK];
+      p->sid->pipeline_filter_chunk(s.n, s.vout[0], s.vout[1], s.vout[2]);
+      p->tail.store(t + 1, std::memory_order_release);
+    }
+  }
+
+  SID* sid;
+  Slot slot[SLOTS];
+  std::atomic<unsigned int> head;
+  std::atomic<unsigned int> tail;
+  std::atomic<bool> stop;
+  std::mutex m;
+  std::condition_variable cv;
+  std::thread worker;
+};
+
+// ----------------------------------------------------------------------------
+// Enable pipelined clocking.
+//
+// With the pipeline enabled, batched clocking with SAMPLE_RESAMPLE splits
+// each call between two threads: the calling thread clocks envelopes and
+// oscillators, staging per voice sample streams chunk by chunk, while a
+// worker thread runs the filter, external filter and resampler one chunk
+// behind. Output is bit exact with the serial path, and each call still
+// returns only when all its samples are complete, so the overlap is
+// confined to the call. Intended for machines with a core to spare - one
+// emulated SID can then use two cores.
+//
+// Voice taps, raw debug output and sampling frequency ramps fall back to
+// the serial path, as do the other sampling methods and the single cycle
+// interface. Filter and resampler profile counters are not accumulated
+// for pipelined calls. Not thread safe against concurrent clocking.
+// ----------------------------------------------------------------------------
+void SID::enable_pipeline(bool enable)
+{
+  if (enable && !pipeline) {
+    pipeline = new SIDPipeline(this);
+  }
+  else if (!enable && pipeline) {
+    delete pipeline;
+    pipeline = 0;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Set per voice tap buffers, see sid.h.
+// ----------------------------------------------------------------------------
+void SID::set_voice_taps(short* tap1, short* tap2, short* tap3,
+                         int interleave)
+{
+  // All taps are written together; a single unset tap disables tapping.
+  if (!tap1 || !tap2 || !tap3) {
+    tap1 = tap2 = tap3 = 0;
+  }
+  tap_buf[0] = tap1;
+  tap_buf[1] = tap2;
+  tap_buf[2] = tap3;
+  tap_interleave = interleave;
+}
+
+// ----------------------------------------------------------------------------
+// Store the per voice tapped outputs accompanying one output sample, and
+// advance the tap pointers. Only called when taps are set.
+// ----------------------------------------------------------------------------
+RESID_INLINE
+void SID::write_voice_taps()
+{
+  for (int i = 0; i < 3; i++) {
+    // The voice DAC output has a digital range of 20 bits.
+    *tap_buf[i] = clip(voice[i].output() >> 4);
+    tap_buf[i] += tap_interleave;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Read the instrumentation counters, see sid.h. The counters stay zero
+// unless the library is compiled with RESID_PROFILE.
+// ----------------------------------------------------------------------------
+SID::Profile SID::read_profile()
+{
+  return profile_counters;
+}
+
+// ----------------------------------------------------------------------------
+// Reset the instrumentation counters.
+// ----------------------------------------------------------------------------
+void SID::reset_profile()
+{
+  profile_counters.envelope = 0;
+  profile_counters.wave = 0;
+  profile_counters.filter = 0;
+  profile_counters.resample = 0;
+  profile_counters.cycles = 0;
+  profile_counters.samples = 0;
+}
+
 // ----------------------------------------------------------------------------
 // I0() computes the 0th order modified Bessel function of the first kind.
 // This function is originally from resample-1.5/filterkit.c by J. O. Smith.
@@ -584,8 +1999,19 @@ double SID::I0(double x)
 bool SID::set_sampling_parameters(double clock_freq, sampling_method method,
                         double sample_freq, double pass_freq, double filter_scale)
 {
+  const double pi = 3.1415926535897932385;
+
+  // 16 bits -> -96dB stopband attenuation.
+  const double A = -20*log10(1.0/(1 << 16));
+
+  // Stage 1 parameters for SAMPLE_RESAMPLE_TWOSTAGE, derived below before
+  // any state is changed, since failure must leave the previous sampling
+  // setup untouched.
+  int decimate_new = 0, stage1_N_new = 0;
+
   // Check resampling constraints.
-  if (method == SAMPLE_RESAMPLE || method == SAMPLE_RESAMPLE_FASTMEM)
+  if (method == SAMPLE_RESAMPLE || method == SAMPLE_RESAMPLE_FASTMEM
+      || method == SAMPLE_RESAMPLE_TWOSTAGE)
   {
     // Check whether the sample ring buffer would overfill.
     if (FIR_N*clock_freq/sample_freq >= RINGSIZE) {
@@ -610,6 +2036,32 @@ bool SID::set_sampling_parameters(double clock_freq, sampling_method method,
     if (filter_scale < 0.9 || filter_scale > 1.0) {
       return false;
     }
+
+    // Check two-stage decimation constraints. Stage 1 decimates the cycle
+    // stream by an integer factor to an intermediate frequency near the
+    // optimum found by Laurent Ganier (see clock_resample below), and the
+    // fractional resampling is then performed on the intermediate stream.
+    // Stage 1 only has to keep the passband free of aliasing; anything
+    // folding onto frequencies above pass_freq is removed by stage 2. This
+    // widens the stage 1 transition band to f_intermediate - 2*pass_freq,
+    // keeping the filter short although it operates at the clock frequency.
+    if (method == SAMPLE_RESAMPLE_TWOSTAGE) {
+      double f_intermediate = 2*pass_freq
+        + sqrt(2*pass_freq*clock_freq*(sample_freq - 2*pass_freq)/sample_freq);
+      decimate_new = int(clock_freq/f_intermediate);
+      if (decimate_new < 2) {
+        // No decimation gain; use SAMPLE_RESAMPLE instead.
+        return false;
+      }
+
+      double dw1 = (clock_freq/decimate_new - 2*pass_freq)*2*pi/clock_freq;
+      stage1_N_new = (int((A - 7.95)/(2.285*dw1) + 0.5) + 1) | 1;
+
+      // Check whether the stage 1 ring buffer would overfill.
+      if (stage1_N_new + clock_freq/sample_freq >= STAGE1_RINGSIZE) {
+        return false;
+      }
+    }
   }
 
   clock_frequency = clock_freq;
@@ -618,23 +2070,35 @@ bool SID::set_sampling_parameters(double clock_freq, sampling_method method,
   cycles_per_sample =
     cycle_count(clock_freq/sample_freq*(1 << FIXP_SHIFT) + 0.5);
 
+  // Cancel any sampling frequency ramp in flight.
+  ramp_target = cycles_per_sample;
+  ramp_remaining = 0;
+
   sample_offset = 0;
   sample_prev = 0;
   sample_now = 0;
+  sample_prev2 = 0;
+  sample_prev3 = 0;
 
   // FIR initialization is only necessary for resampling.
-  if (method != SAMPLE_RESAMPLE && method != SAMPLE_RESAMPLE_FASTMEM)
+  if (method != SAMPLE_RESAMPLE && method != SAMPLE_RESAMPLE_FASTMEM
+      && method != SAMPLE_RESAMPLE_TWOSTAGE)
   {
-    delete[] sample;
-    delete[] fir;
+    buffer_free(sample);
+    release_fir();
     sample = 0;
-    fir = 0;
+    buffer_free(stage1_fir);
+    stage1_fir = 0;
+    buffer_free(stage1_sample);
+    stage1_sample = 0;
+    stage1_N = 0;
+    decimate = 0;
     return true;
   }
 
   // Allocate sample buffer.
   if (!sample) {
-    sample = new short[RINGSIZE*2];
+    sample = buffer_alloc(RINGSIZE*2);
   }
   // Clear sample buffer.
   for (int j = 0; j < RINGSIZE*2; j++) {
@@ -642,20 +2106,13 @@ bool SID::set_sampling_parameters(double clock_freq, sampling_method method,
   }
   sample_index = 0;
 
-  const double pi = 3.1415926535897932385;
-
-  // 16 bits -> -96dB stopband attenuation.
-  const double A = -20*log10(1.0/(1 << 16));
   // A fraction of the bandwidth is allocated to the transition band,
   double dw = (1 - 2*pass_freq/sample_freq)*pi*2;
-  // The cutoff frequency is midway through the transition band (nyquist)
-  double wc = pi;
 
   // For calculation of beta and N see the reference for the kaiserord
   // function in the MATLAB Signal Processing Toolbox:
   // http://www.mathworks.com/access/helpdesk/help/toolbox/signal/kaiserord.html
   const double beta = 0.1102*(A - 8.7);
-  const double I0beta = I0(beta);
 
   // The filter order will maximally be 124 with the current constraints.
   // N >= (96.33 - 7.95)/(2.285*0.1*pi) -> N >= 123
@@ -664,9 +2121,51 @@ bool SID::set_sampling_parameters(double clock_freq, sampling_method method,
   int N = int((A - 7.95)/(2.285*dw) + 0.5);
   N += N & 1;
 
-  double f_samples_per_cycle = sample_freq/clock_freq;
   double f_cycles_per_sample = clock_freq/sample_freq;
 
+  if (method == SAMPLE_RESAMPLE_TWOSTAGE) {
+    decimate = decimate_new;
+    stage1_N = stage1_N_new;
+    buffer_free(stage1_fir);
+    stage1_fir = buffer_alloc(stage1_N);
+
+    // Kaiser windowed sinc with the cutoff midway through the stage 1
+    // transition band, i.e. at half the intermediate frequency.
+    double wc1 = pi/decimate;
+    double I0beta = I0(beta);
+    for (int j = 0; j < stage1_N; j++) {
+      double jx = j - stage1_N/2;
+      double wt = wc1*jx;
+      double temp = jx/(stage1_N/2);
+      double Kaiser =
+        fabs(temp) <= 1 ? I0(beta*sqrt(1 - temp*temp))/I0beta : 0;
+      double sincwt = fabs(wt) >= 1e-6 ? sin(wt)/wt : 1;
+      double val = (1 << FIR_SHIFT)*wc1/pi*sincwt*Kaiser;
+      stage1_fir[j] = (short)round(val);
+    }
+
+    if (!stage1_sample) {
+      stage1_sample = buffer_alloc(STAGE1_RINGSIZE*2);
+    }
+    for (int j = 0; j < STAGE1_RINGSIZE*2; j++) {
+      stage1_sample[j] = 0;
+    }
+    stage1_index = 0;
+    decimate_index = 0;
+
+    // The fractional resampler below operates on the intermediate sample
+    // stream instead of on raw cycles.
+    f_cycles_per_sample /= decimate;
+  }
+  else {
+    buffer_free(stage1_fir);
+    stage1_fir = 0;
+    buffer_free(stage1_sample);
+    stage1_sample = 0;
+    stage1_N = 0;
+    decimate = 0;
+  }
+
   // The filter length is equal to the filter order + 1.
   // The filter length must be an odd number (sinc is symmetric about x = 0).
   int fir_N_new = int(N*f_cycles_per_sample) + 1;
@@ -674,8 +2173,8 @@ bool SID::set_sampling_parameters(double clock_freq, sampling_method method,
 
   // We clamp the filter table resolution to 2^n, making the fixed point
   // sample_offset a whole multiple of the filter table resolution.
-  int res = method == SAMPLE_RESAMPLE ?
-    FIR_RES : FIR_RES_FASTMEM;
+  int res = method == SAMPLE_RESAMPLE_FASTMEM ?
+    FIR_RES_FASTMEM : FIR_RES;
   int n = (int)ceil(log(res/f_cycles_per_sample)/log(2.0f));
   int fir_RES_new = 1 << n;
 
@@ -691,26 +2190,12 @@ bool SID::set_sampling_parameters(double clock_freq, sampling_method method,
   fir_f_cycles_per_sample = f_cycles_per_sample;
   fir_filter_scale = filter_scale;
 
-  // Allocate memory for FIR tables.
-  delete[] fir;
-  fir = new short[fir_N*fir_RES];
-
-  // Calculate fir_RES FIR tables for linear interpolation.
-  for (int i = 0; i < fir_RES; i++) {
-    int fir_offset = i*fir_N + fir_N/2;
-    double j_offset = double(i)/fir_RES;
-    // Calculate FIR table. This is the sinc function, weighted by the
-    // Kaiser window.
-    for (int j = -fir_N/2; j <= fir_N/2; j++) {
-      double jx = j - j_offset;
-      double wt = wc*jx/f_cycles_per_sample;
-      double temp = jx/(fir_N/2);
-      double Kaiser = fabs(temp) <= 1 ? I0(beta*sqrt(1 - temp*temp))/I0beta : 0;
-      double sincwt = fabs(wt) >= 1e-6 ? sin(wt)/wt : 1;
-      double val = (1 << FIR_SHIFT)*filter_scale*f_samples_per_cycle*wc/pi*sincwt*Kaiser;
-      fir[fir_offset + j] = (short)round(val);
-    }
-  }
+  // Look up the table in the process-wide cache; instances with matching
+  // parameters share one immutable copy.
+  release_fir();
+  fir_handle = acquire_fir_table(fir_N, fir_RES, beta, f_cycles_per_sample,
+                                 filter_scale);
+  fir = fir_handle->data;
 
   return true;
 }
@@ -732,6 +2217,54 @@ void SID::adjust_sampling_frequency(double sample_freq)
 {
   cycles_per_sample =
     cycle_count(clock_frequency/sample_freq*(1 << FIXP_SHIFT) + 0.5);
+
+  // Cancel any sampling frequency ramp in flight.
+  ramp_target = cycles_per_sample;
+  ramp_remaining = 0;
+}
+
+
+// ----------------------------------------------------------------------------
+// Adjustment of SID sampling frequency, slewed over a number of samples.
+//
+// This serves the same purpose as adjust_sampling_frequency, but instead of
+// stepping the sample period at once the change is spread evenly over the
+// next slew_samples output samples. Periodic small rate nudges, e.g. for
+// locking audio to a display refresh, thus cause no step in the sample
+// period. As for adjust_sampling_frequency the resampling filter is not
+// rebuilt, so the adjustment should stay within a fraction of a percent of
+// the sampling frequency the filter was designed for, well within the
+// filter's transition band.
+//
+// A new call supersedes any ramp still in flight, starting from the
+// current sample period.
+// ----------------------------------------------------------------------------
+void SID::ramp_sampling_frequency(double sample_freq, int slew_samples)
+{
+  ramp_target =
+    cycle_count(clock_frequency/sample_freq*(1 << FIXP_SHIFT) + 0.5);
+
+  if (slew_samples <= 0 || ramp_target == cycles_per_sample) {
+    cycles_per_sample = ramp_target;
+    ramp_remaining = 0;
+    return;
+  }
+
+  ramp_remaining = slew_samples;
+}
+
+
+// ----------------------------------------------------------------------------
+// Advance an ongoing sampling frequency ramp by one output sample.
+// The remaining difference is divided by the remaining sample count,
+// converging on the target with no accumulated rounding error.
+// ----------------------------------------------------------------------------
+void SID::step_frequency_ramp()
+{
+  cycles_per_sample += (ramp_target - cycles_per_sample)/ramp_remaining;
+  if (--ramp_remaining == 0) {
+    cycles_per_sample = ramp_target;
+  }
 }
 
 
@@ -762,11 +2295,16 @@ void SID::clock(cycle_count delta_t)
     bus_value_ttl = 0;
   }
 
+  PROFILE_COUNT(cycles, delta_t);
+  PROFILE_TICK(profile_t);
+
   // Clock amplitude modulators.
   for (i = 0; i < 3; i++) {
     voice[i].envelope.clock(delta_t);
   }
 
+  PROFILE_ACCUM(envelope, profile_t);
+
   // Clock and synchronize oscillators.
   // Loop until we reach the current cycle.
   cycle_count delta_t_osc = delta_t;
@@ -820,29 +2358,373 @@ void SID::clock(cycle_count delta_t)
     voice[i].wave.set_waveform_output(delta_t);
   }
 
+  PROFILE_ACCUM(wave, profile_t);
+
   // Clock filter.
   filter.clock(delta_t, voice[0].output(), voice[1].output(), voice[2].output());
 
   // Clock external filter.
   extfilt.clock(delta_t, filter.output());
+
+  PROFILE_ACCUM(filter, profile_t);
 }
 
 
 // ----------------------------------------------------------------------------
-// SID clocking with audio sampling.
-// Fixed point arithmetics are used.
+// Number of cycles until the next internally scheduled state change.
 //
-// The example below shows how to clock the SID a specified amount of cycles
-// while producing audio output:
+// This allows a host scheduler to ask the chip how far it can safely be
+// fast-forwarded with clock(delta_t) between register accesses, instead
+// of clocking conservatively in small steps, e.g. per scanline. The
+// horizon covers the timed countdowns: the envelope rate counters and
+// pipelines, the noise shift register pipeline and reset, the floating
+// waveform output fade, pipelined writes, and the bus value TTL.
+// Continuous oscillator state (accumulator, hard sync, noise shift
+// register clocking) is not included, since clock(delta_t) steps it
+// exactly in closed form for any delta_t.
 //
-// while (delta_t) {
-//   bufindex += sid.clock(delta_t, buf + bufindex, buflength - bufindex);
-//   write(dsp, buf, bufindex*2);
-//   bufindex = 0;
+// If no event is scheduled, the maximum cycle_count value is returned.
+// ----------------------------------------------------------------------------
+cycle_count SID::next_event()
+{
+  cycle_count t_min = 0x7fffffff;
+
+  // Pipelined writes on the MOS8580.
+  if (unlikely(write_pipeline)) {
+    return 1;
+  }
+
+  // Age of bus value.
+  if (bus_value_ttl > 0 && bus_value_ttl < t_min) {
+    t_min = bus_value_ttl;
+  }
+
+  for (int i = 0; i < 3; i++) {
+    cycle_count t = voice[i].envelope.next_event();
+    if (t < t_min) {
+      t_min = t;
+    }
+    t = voice[i].wave.next_event();
+    if (t < t_min) {
+      t_min = t;
+    }
+  }
+
+  return t_min;
+}
+
+
+// ----------------------------------------------------------------------------
+// SID clocking with per cycle audio output - delta_t cycles.
+//
+// The single cycle interface above advances all subsystems in lockstep,
+// paying the full state footprint of the chip every cycle. When a block of
+// cycles is to be clocked, it is faster to advance each subsystem over the
+// whole block in turn, keeping its state in registers, with the voice
+// outputs staged in a small stack buffer which is then consumed by the
+// filters. This is permissible since the amplitude modulators and
+// oscillators are independent of the filters, and since the oscillators
+// only interact via hard sync and ring modulation, which is checked for
+// below.
+//
+// One clipped audio output sample is stored per cycle in buf, which must
+// hold delta_t samples.
+// ----------------------------------------------------------------------------
+RESID_TARGET_CLONES
+void SID::clock_block(cycle_count delta_t, short* buf)
+{
+  int i;
+
+  PROFILE_COUNT(cycles, delta_t);
+
+  // Pipelined writes on the MOS8580.
+  // Step single cycles until the pipeline is empty.
+  while (unlikely(write_pipeline) && likely(delta_t > 0)) {
+    clock();
+    *buf++ = clip(output());
+    --delta_t;
+  }
+
+  if (unlikely(delta_t <= 0)) {
+    return;
+  }
+
+  // Age bus value. The single cycle interface resets the bus value on the
+  // cycle the TTL countdown reaches zero.
+  if (bus_value_ttl > 0 && bus_value_ttl <= delta_t) {
+    bus_value = 0;
+  }
+  bus_value_ttl -= delta_t;
+
+  // The oscillators may only be advanced independently of each other as
+  // long as no oscillator can reset another via hard sync, and no
+  // oscillator reads another via ring modulation. Register writes cannot
+  // occur within the block, so this needs only be checked once.
+  bool coupled = false;
+  for (i = 0; i < 3; i++) {
+    WaveformGenerator& wave = voice[i].wave;
+    if ((wave.sync_dest->sync && wave.freq) || wave.ring_msb_mask) {
+      coupled = true;
+      break;
+    }
+  }
+
+  enum { blocksize = 32 };
+
+  while (delta_t > 0) {
+    int vout[3][blocksize];
+    cycle_count n = delta_t < blocksize ? delta_t : cycle_count(blocksize);
+
+    clock_voice_block(n, coupled, vout[0], vout[1], vout[2]);
+
+    PROFILE_TICK(profile_t);
+
+    // Clock filters; the raw debug output tap keeps the generic loop.
+    if (likely(!raw_debug_output)) {
+      clock_filter_dispatch(n, vout[0], vout[1], vout[2], buf);
+    }
+    else {
+      for (cycle_count c = 0; c < n; c++) {
+        filter.clock(vout[0][c], vout[1][c], vout[2][c]);
+        extfilt.clock(filter.output());
+        buf[c] = clip(output());
+        debugoutput();
+      }
+    }
+
+    PROFILE_ACCUM(filter, profile_t);
+
+    buf += n;
+    delta_t -= n;
+  }
+}
+
+
+// ----------------------------------------------------------------------------
+// Stage 1 of clock_block: clock amplitude modulators and oscillators,
+// staging the per voice sample streams. Register state must be constant
+// across the block.
+// ----------------------------------------------------------------------------
+RESID_INLINE
+void SID::clock_voice_block(cycle_count n, bool coupled,
+                            int* v1, int* v2, int* v3)
+{
+  int* const vout[3] = { v1, v2, v3 };
+  int i;
+  cycle_count c;
+
+  PROFILE_TICK(profile_t);
+
+  // Clock amplitude modulators, staging the envelope DAC outputs.
+  for (i = 0; i < 3; i++) {
+    EnvelopeGenerator& envelope = voice[i].envelope;
+    for (c = 0; c < n; c++) {
+      envelope.clock();
+      vout[i][c] = envelope.output();
+    }
+  }
+
+  PROFILE_ACCUM(envelope, profile_t);
+
+  // Clock oscillators, modulating the staged envelope DAC outputs with
+  // the waveform outputs.
+  if (likely(!coupled)) {
+    // Each oscillator is advanced over the whole block in turn.
+    // Synchronization can be skipped altogether; since no oscillator
+    // which is a sync source has freq != 0, no MSB can be set high.
+    for (i = 0; i < 3; i++) {
+      WaveformGenerator& wave = voice[i].wave;
+      int wave_zero = voice[i].wave_zero;
+      for (c = 0; c < n; c++) {
+        wave.clock();
+        wave.set_waveform_output();
+        vout[i][c] *= wave.output() - wave_zero;
+      }
+    }
+  }
+  else {
+    // Clock and synchronize the oscillators in lockstep as in the
+    // single cycle interface.
+    for (c = 0; c < n; c++) {
+      for (i = 0; i < 3; i++) {
+        voice[i].wave.clock();
+      }
+      for (i = 0; i < 3; i++) {
+        voice[i].wave.synchronize();
+      }
+      for (i = 0; i < 3; i++) {
+        voice[i].wave.set_waveform_output();
+        vout[i][c] *= voice[i].wave.output() - voice[i].wave_zero;
+      }
+    }
+  }
+
+  PROFILE_ACCUM(wave, profile_t);
+}
+
+
+// ----------------------------------------------------------------------------
+// Stage 2 of clock_block: the filter stage loop, specialized on the
+// configuration, which is constant across the block.
+// ----------------------------------------------------------------------------
+RESID_INLINE
+void SID::clock_filter_dispatch(cycle_count n, const int* v1, const int* v2,
+                                const int* v3, short* buf)
+{
+  if (likely(filter.enabled)) {
+    if (likely(extfilt.enabled)) {
+      clock_filter_block<true, true>(n, v1, v2, v3, buf);
+    }
+    else {
+      clock_filter_block<true, false>(n, v1, v2, v3, buf);
+    }
+  }
+  else if (extfilt.enabled) {
+    clock_filter_block<false, true>(n, v1, v2, v3, buf);
+  }
+  else {
+    clock_filter_block<false, false>(n, v1, v2, v3, buf);
+  }
+}
+
+
+// ----------------------------------------------------------------------------
+// Filter stage loop of clock_block.
+// The template parameters select the stages enabled for the whole block:
+// with the filter disabled the integrators are not clocked, and with the
+// external filter disabled its state is brought up to date once at the
+// end of the block instead of every cycle. The per cycle loop then
+// carries no branches or loads for disabled stages.
+// ----------------------------------------------------------------------------
+template<bool filter_enabled, bool extfilt_enabled>
+RESID_INLINE
+void SID::clock_filter_block(cycle_count n, const int* v1, const int* v2,
+                             const int* v3, short* buf)
+{
+  for (cycle_count c = 0; c < n; c++) {
+    if (filter_enabled) {
+      filter.clock(v1[c], v2[c], v3[c]);
+    }
+    else {
+      filter.clock_bypass(v1[c], v2[c], v3[c]);
+    }
+
+    if (extfilt_enabled) {
+      extfilt.clock_enabled(filter.output());
+      buf[c] = clip(output());
+    }
+    else {
+      // The filter output is already a clipped 16 bit sample.
+      buf[c] = filter.output();
+    }
+  }
+
+  if (!extfilt_enabled) {
+    // Clocking the disabled external filter tracks the last input only;
+    // one clock at the end of the block yields the same state as
+    // clocking it every cycle.
+    extfilt.clock(buf[n - 1]);
+  }
+}
+
+
+// ----------------------------------------------------------------------------
+// SID clocking with audio sampling.
+// Fixed point arithmetics are used.
+//
+// The example below shows how to clock the SID a specified amount of cycles
+// while producing audio output:
+//
+// while (delta_t) {
+//   bufindex += sid.clock(delta_t, buf + bufindex, buflength - bufindex);
+//   write(dsp, buf, bufindex*2);
+//   bufindex = 0;
 // }
 //
 // ----------------------------------------------------------------------------
 int SID::clock(cycle_count& delta_t, short* buf, int n, int interleave)
+{
+  if (likely(write_queue_head == write_queue_tail)) {
+    return clock_sample(delta_t, buf, n, interleave);
+  }
+
+  // Clock in segments, applying queued register writes at their scheduled
+  // cycle positions.
+  int s = 0;
+  for (;;) {
+    // Apply all writes scheduled for the current cycle.
+    while (write_queue_head != write_queue_tail
+           && write_queue[write_queue_head].offset == 0)
+    {
+      write_event& e = write_queue[write_queue_head];
+      write(e.address, e.value);
+      write_queue_head = (write_queue_head + 1) & WRITE_QUEUE_MASK;
+    }
+
+    if (write_queue_head == write_queue_tail) {
+      write_queue_end = 0;
+      s += clock_sample(delta_t, buf + s*interleave, n - s, interleave);
+      return s;
+    }
+
+    if (!delta_t || s >= n) {
+      return s;
+    }
+
+    // Clock up to the next queued event.
+    cycle_count delta_t_seg = write_queue[write_queue_head].offset;
+    if (delta_t_seg > delta_t) {
+      delta_t_seg = delta_t;
+    }
+
+    cycle_count t = delta_t_seg;
+    s += clock_sample(t, buf + s*interleave, n - s, interleave);
+    cycle_count clocked = delta_t_seg - t;
+    delta_t -= clocked;
+    write_queue[write_queue_head].offset -= clocked;
+    write_queue_end -= clocked;
+
+    if (unlikely(t != 0)) {
+      // The sample buffer was filled before the segment was completed.
+      return s;
+    }
+  }
+}
+
+
+// ----------------------------------------------------------------------------
+// SID clocking with audio sampling - normalized float output.
+//
+// Samples are rendered by the selected sampling method and converted to
+// floats in [-1, 1) in cache resident chunks, so float mixers need no
+// separate conversion pass over the full buffer. The output is identical
+// to the short variant scaled by 1/32768, and the clocked state is the
+// same whichever variant is used.
+// ----------------------------------------------------------------------------
+int SID::clock(cycle_count& delta_t, float* buf, int n, int interleave)
+{
+  int s = 0;
+
+  while (s < n && delta_t) {
+    short sbuf[1024];
+    int m = n - s < 1024 ? n - s : 1024;
+    m = clock(delta_t, sbuf, m);
+    // Convert while the chunk is still cache resident. For interleave 1
+    // the loop is a pure widening conversion, vectorized by the compiler.
+    for (int i = 0; i < m; i++) {
+      buf[(s + i)*interleave] = sbuf[i]*(1.0f/32768);
+    }
+    s += m;
+  }
+
+  return s;
+}
+
+
+// ----------------------------------------------------------------------------
+// Dispatch to the selected sampling method.
+// ----------------------------------------------------------------------------
+int SID::clock_sample(cycle_count& delta_t, short* buf, int n, int interleave)
 {
   switch (sampling) {
   default:
@@ -850,10 +2732,14 @@ int SID::clock(cycle_count& delta_t, short* buf, int n, int interleave)
     return clock_fast(delta_t, buf, n, interleave);
   case SAMPLE_INTERPOLATE:
     return clock_interpolate(delta_t, buf, n, interleave);
+  case SAMPLE_INTERPOLATE_CUBIC:
+    return clock_interpolate_cubic(delta_t, buf, n, interleave);
   case SAMPLE_RESAMPLE:
     return clock_resample(delta_t, buf, n, interleave);
   case SAMPLE_RESAMPLE_FASTMEM:
     return clock_resample_fastmem(delta_t, buf, n, interleave);
+  case SAMPLE_RESAMPLE_TWOSTAGE:
+    return clock_resample_twostage(delta_t, buf, n, interleave);
   }
 }
 
@@ -882,8 +2768,16 @@ int SID::clock_fast(cycle_count& delta_t, short* buf, int n, int interleave)
 
     sample_offset = (next_sample_offset & FIXP_MASK) - (1 << (FIXP_SHIFT - 1));
     buf[s*interleave] = amplify(output(), scaleFactor);
+    if (unlikely(tap_buf[0] != 0)) {
+      write_voice_taps();
+    }
+    if (unlikely(ramp_remaining)) {
+      step_frequency_ramp();
+    }
   }
 
+  PROFILE_COUNT(samples, s);
+
   return s;
 }
 
@@ -909,11 +2803,22 @@ int SID::clock_interpolate(cycle_count& delta_t, short* buf, int n, int interlea
       delta_t_sample = delta_t;
     }
 
-    for (int i = delta_t_sample; i > 0; i--) {
-      clock();
-      if (unlikely(i <= 2)) {
-        sample_prev = sample_now;
-        sample_now = clip(output());
+    // Clock in blocks, keeping the output of the last two cycles for the
+    // linear interpolation below.
+    short sbuf[128];
+    for (cycle_count t = delta_t_sample; t > 0;) {
+      cycle_count nb = t < 128 ? t : cycle_count(128);
+      clock_block(nb, sbuf);
+      t -= nb;
+      if (t == 0) {
+        if (likely(nb >= 2)) {
+          sample_prev = sbuf[nb - 2];
+          sample_now = sbuf[nb - 1];
+        }
+        else if (nb == 1) {
+          sample_prev = sample_now;
+          sample_now = sbuf[0];
+        }
       }
     }
 
@@ -928,12 +2833,115 @@ int SID::clock_interpolate(cycle_count& delta_t, short* buf, int n, int interlea
       sample_prev + (sample_offset*(sample_now - sample_prev) >> FIXP_SHIFT),
       scaleFactor
     );
+    if (unlikely(tap_buf[0] != 0)) {
+      write_voice_taps();
+    }
+    if (unlikely(ramp_remaining)) {
+      step_frequency_ramp();
+    }
   }
 
+  PROFILE_COUNT(samples, s);
+
   return s;
 }
 
 
+// ----------------------------------------------------------------------------
+// SID clocking with audio sampling - cycle based with cubic sample
+// interpolation.
+//
+// Catmull-Rom interpolation through the four most recent cycle outputs,
+// evaluated between the two middle points. This suppresses considerably
+// more of the imaging above the passband than the linear interpolation
+// above, for nearly the same per-sample cost, at the price of one cycle
+// of added latency. It is no substitute for the resampling methods when
+// full 16 bit quality is required.
+// ----------------------------------------------------------------------------
+int SID::clock_interpolate_cubic(cycle_count& delta_t, short* buf, int n, int interleave)
+{
+  int s;
+
+  for (s = 0; s < n; s++) {
+    cycle_count next_sample_offset = sample_offset + cycles_per_sample;
+    cycle_count delta_t_sample = next_sample_offset >> FIXP_SHIFT;
+
+    if (delta_t_sample > delta_t) {
+      delta_t_sample = delta_t;
+    }
+
+    // Clock in blocks, keeping the output of the last four cycles for the
+    // interpolation below. Unlike the linear case the history is updated
+    // for every block, since the final block may hold fewer than four
+    // cycles.
+    short sbuf[128];
+    for (cycle_count t = delta_t_sample; t > 0;) {
+      cycle_count nb = t < 128 ? t : cycle_count(128);
+      clock_block(nb, sbuf);
+      t -= nb;
+      for (cycle_count c = nb >= 4 ? nb - 4 : 0; c < nb; c++) {
+        sample_prev3 = sample_prev2;
+        sample_prev2 = sample_prev;
+        sample_prev = sample_now;
+        sample_now = sbuf[c];
+      }
+    }
+
+    if ((delta_t -= delta_t_sample) == 0) {
+      sample_offset -= delta_t_sample << FIXP_SHIFT;
+      break;
+    }
+
+    sample_offset = next_sample_offset & FIXP_MASK;
+
+    // The spline passes through sample_prev2 and sample_prev with
+    // tangents given by the surrounding points, evaluated in Horner
+    // form. The coefficient magnitudes exceed 16 bits, so the fixed
+    // point products are taken in 64 bits.
+    int p0 = sample_prev3;
+    int p1 = sample_prev2;
+    int p2 = sample_prev;
+    int p3 = sample_now;
+    int c3 = 3*(p1 - p2) + p3 - p0;
+    int c2 = 2*p0 - 5*p1 + 4*p2 - p3;
+    int c1 = p2 - p0;
+    int v = int((long long)c3*sample_offset >> FIXP_SHIFT);
+    v = int((long long)(v + c2)*sample_offset >> FIXP_SHIFT);
+    v = int((long long)(v + c1)*sample_offset >> (FIXP_SHIFT + 1)) + p1;
+
+    buf[s*interleave] = amplify(v, scaleFactor);
+    if (unlikely(tap_buf[0] != 0)) {
+      write_voice_taps();
+    }
+    if (unlikely(ramp_remaining)) {
+      step_frequency_ramp();
+    }
+  }
+
+  PROFILE_COUNT(samples, s);
+
+  return s;
+}
+
+
+// ----------------------------------------------------------------------------
+// Triangular (TPDF) dither spanning +/- one output LSB, i.e. the sum of
+// two uniform variables of half an LSB each, drawn from two halves of a
+// xorshift32 state. See enable_dither.
+// ----------------------------------------------------------------------------
+RESID_INLINE int SID::next_dither()
+{
+  unsigned int r = dither_state;
+  r ^= r << 13;
+  r ^= r >> 17;
+  r ^= r << 5;
+  dither_state = r;
+
+  const int mask = (1 << FIR_SHIFT) - 1;
+  return (int)(r & mask) + (int)((r >> 16) & mask) - mask;
+}
+
+
 // ----------------------------------------------------------------------------
 // SID clocking with audio sampling - cycle based with audio resampling.
 //
@@ -974,6 +2982,19 @@ int SID::clock_resample(cycle_count& delta_t, short* buf, int n, int interleave)
 {
   int s;
 
+  // Hand the call to the pipelined variant when a worker is attached and
+  // can be kept busy. Voice taps, raw debug output, pipelined register
+  // writes, frequency ramps and sample periods below one cycle keep the
+  // serial path.
+  if (unlikely(pipeline != 0)
+      && likely(tap_buf[0] == 0) && likely(!raw_debug_output)
+      && likely(!write_pipeline) && likely(!ramp_remaining)
+      && cycles_per_sample >= (1 << FIXP_SHIFT)
+      && delta_t > SIDPipeline::CHUNK)
+  {
+    return clock_resample_pipelined(delta_t, buf, n, interleave);
+  }
+
   for (s = 0; s < n; s++) {
     cycle_count next_sample_offset = sample_offset + cycles_per_sample;
     cycle_count delta_t_sample = next_sample_offset >> FIXP_SHIFT;
@@ -982,10 +3003,18 @@ int SID::clock_resample(cycle_count& delta_t, short* buf, int n, int interleave)
       delta_t_sample = delta_t;
     }
 
-    for (int i = 0; i < delta_t_sample; i++) {
-      clock();
-      sample[sample_index] = sample[sample_index + RINGSIZE] = clip(output());
-      ++sample_index &= RINGMASK;
+    // Clock in blocks, writing one sample per cycle directly into the ring
+    // buffer, and mirroring each block into the overflow copy.
+    for (cycle_count t = delta_t_sample; t > 0;) {
+      cycle_count nb = RINGSIZE - sample_index;
+      if (t < nb) {
+        nb = t;
+      }
+      clock_block(nb, sample + sample_index);
+      memcpy(sample + sample_index + RINGSIZE, sample + sample_index,
+             nb*sizeof(short));
+      sample_index = (sample_index + nb) & RINGMASK;
+      t -= nb;
     }
 
     if ((delta_t -= delta_t_sample) == 0) {
@@ -995,16 +3024,15 @@ int SID::clock_resample(cycle_count& delta_t, short* buf, int n, int interleave)
 
     sample_offset = next_sample_offset & FIXP_MASK;
 
+    PROFILE_TICK(profile_t);
+
     int fir_offset = sample_offset*fir_RES >> FIXP_SHIFT;
     int fir_offset_rmd = sample_offset*fir_RES & FIXP_MASK;
-    short* fir_start = fir + fir_offset*fir_N;
+    const short* fir_start = fir + fir_offset*fir_N;
     short* sample_start = sample + sample_index - fir_N - 1 + RINGSIZE;
 
     // Convolution with filter impulse response.
-    int v1 = 0;
-    for (int j = 0; j < fir_N; j++) {
-      v1 += sample_start[j]*fir_start[j];
-    }
+    int v1 = fir_convolve(sample_start, fir_start, fir_N);
 
     // Use next FIR table, wrap around to first FIR table using
     // next sample.
@@ -1015,25 +3043,193 @@ int SID::clock_resample(cycle_count& delta_t, short* buf, int n, int interleave)
     fir_start = fir + fir_offset*fir_N;
 
     // Convolution with filter impulse response.
-    int v2 = 0;
-    for (int k = 0; k < fir_N; k++) {
-      v2 += sample_start[k]*fir_start[k];
-    }
+    int v2 = fir_convolve(sample_start, fir_start, fir_N);
 
     // Linear interpolation.
     // fir_offset_rmd is equal for all samples, it can thus be factorized out:
     // sum(v1 + rmd*(v2 - v1)) = sum(v1) + rmd*(sum(v2) - sum(v1))
     int v = v1 + int((unsigned(fir_offset_rmd)*unsigned(v2 - v1)) >> FIXP_SHIFT);
 
+    if (unlikely(dither_enabled)) {
+      v += next_dither();
+    }
     v >>= FIR_SHIFT;
 
+    PROFILE_ACCUM(resample, profile_t);
+
     buf[s*interleave] = amplify(v, scaleFactor);
+    if (unlikely(tap_buf[0] != 0)) {
+      write_voice_taps();
+    }
+    if (unlikely(ramp_remaining)) {
+      step_frequency_ramp();
+    }
   }
 
+  PROFILE_COUNT(samples, s);
+
   return s;
 }
 
 
+// ----------------------------------------------------------------------------
+// Pipelined variant of clock_resample. The caller's thread stages the per
+// voice sample streams chunk by chunk (clock_voice_block), while the worker
+// thread runs the filters and the resampler (pipeline_filter_chunk). The
+// workload splits roughly evenly between the two stages, and the output is
+// bit identical to the serial path.
+//
+// The number of cycles to clock is bounded by the number of cycles needed
+// to fill the output buffer, exactly as the serial per sample loop would;
+// the remainder is left in delta_t. pipe_total carries the original
+// delta_t to the worker, which stops emitting one sample short of its
+// exhaustion just as the serial loop breaks before emitting.
+//
+// NB! the filter and resampler profile counters are not accumulated for
+// pipelined calls, since they run on the worker thread.
+// ----------------------------------------------------------------------------
+int SID::clock_resample_pipelined(cycle_count& delta_t, short* buf, int n,
+                                  int interleave)
+{
+  int i;
+
+  // Number of cycles consumed by n samples, given the current sample
+  // phase. The serial loop clocks this in per sample pieces.
+  cycle_count needed =
+    (cycle_count)(((long long)sample_offset
+                   + (long long)n*cycles_per_sample) >> FIXP_SHIFT);
+  cycle_count clock_cycles = delta_t < needed ? delta_t : needed;
+
+  PROFILE_COUNT(cycles, clock_cycles);
+
+  // Age bus value, as in clock_block.
+  if (bus_value_ttl > 0 && bus_value_ttl <= clock_cycles) {
+    bus_value = 0;
+  }
+  bus_value_ttl -= clock_cycles;
+
+  // Check for coupled oscillators once, as in clock_block; register
+  // writes cannot occur within the call.
+  bool coupled = false;
+  for (i = 0; i < 3; i++) {
+    WaveformGenerator& wave = voice[i].wave;
+    if ((wave.sync_dest->sync && wave.freq) || wave.ring_msb_mask) {
+      coupled = true;
+      break;
+    }
+  }
+
+  pipe_buf = buf;
+  pipe_n = n;
+  pipe_s = 0;
+  pipe_interleave = interleave;
+  pipe_total = delta_t;
+  pipe_consumed = 0;
+  pipe_avail = 0;
+
+  // Stage the voice sample streams chunk by chunk. Publishing a slot
+  // (submit) makes the producer's state writes above visible to the
+  // worker; the worker's state is read back only after drain.
+  for (cycle_count t = clock_cycles; t > 0;) {
+    SIDPipeline::Slot& slot = pipeline->acquire_slot();
+    cycle_count nc = t < cycle_count(SIDPipeline::CHUNK)
+      ? t : cycle_count(SIDPipeline::CHUNK);
+    clock_voice_block(nc, coupled, slot.vout[0], slot.vout[1], slot.vout[2]);
+    slot.n = nc;
+    pipeline->submit();
+    t -= nc;
+  }
+
+  pipeline->drain();
+
+  // Account for the cycles clocked past the last emitted sample, exactly
+  // as the serial loop does when delta_t runs out mid sample period.
+  sample_offset -= pipe_avail << FIXP_SHIFT;
+  pipe_avail = 0;
+  delta_t -= clock_cycles;
+
+  PROFILE_COUNT(samples, pipe_s);
+
+  return pipe_s;
+}
+
+
+// ----------------------------------------------------------------------------
+// Worker half of the pipelined resampler: clock the filters over a staged
+// chunk of voice samples into the ring buffer, then emit any output
+// samples which have become due. The per sample bookkeeping mirrors the
+// serial loop in clock_resample.
+// ----------------------------------------------------------------------------
+void SID::pipeline_filter_chunk(cycle_count n, const int* v1, const int* v2,
+                                const int* v3)
+{
+  // Clock filters into the ring buffer, mirroring each block into the
+  // overflow copy.
+  for (cycle_count done = 0; done < n;) {
+    cycle_count nb = RINGSIZE - sample_index;
+    if (n - done < nb) {
+      nb = n - done;
+    }
+    clock_filter_dispatch(nb, v1 + done, v2 + done, v3 + done,
+                          sample + sample_index);
+    memcpy(sample + sample_index + RINGSIZE, sample + sample_index,
+           nb*sizeof(short));
+    sample_index = (sample_index + nb) & RINGMASK;
+    done += nb;
+  }
+
+  pipe_avail += n;
+
+  while (pipe_s < pipe_n) {
+    cycle_count next_sample_offset = sample_offset + cycles_per_sample;
+    cycle_count delta_t_sample = next_sample_offset >> FIXP_SHIFT;
+
+    // The serial loop breaks before emitting when delta_t is exhausted,
+    // hence the strict comparison against the original delta_t.
+    if (delta_t_sample > pipe_avail
+        || pipe_consumed + delta_t_sample >= pipe_total) {
+      break;
+    }
+
+    pipe_avail -= delta_t_sample;
+    pipe_consumed += delta_t_sample;
+    sample_offset = next_sample_offset & FIXP_MASK;
+
+    int fir_offset = sample_offset*fir_RES >> FIXP_SHIFT;
+    int fir_offset_rmd = sample_offset*fir_RES & FIXP_MASK;
+    const short* fir_start = fir + fir_offset*fir_N;
+    int emit_index = (sample_index - pipe_avail) & RINGMASK;
+    short* sample_start = sample + emit_index - fir_N - 1 + RINGSIZE;
+
+    // Convolution with filter impulse response.
+    int v1s = fir_convolve(sample_start, fir_start, fir_N);
+
+    // Use next FIR table, wrap around to first FIR table using
+    // next sample.
+    if (unlikely(++fir_offset == fir_RES)) {
+      fir_offset = 0;
+      ++sample_start;
+    }
+    fir_start = fir + fir_offset*fir_N;
+
+    // Convolution with filter impulse response.
+    int v2s = fir_convolve(sample_start, fir_start, fir_N);
+
+    // Linear interpolation.
+    int v = v1s
+      + int((unsigned(fir_offset_rmd)*unsigned(v2s - v1s)) >> FIXP_SHIFT);
+
+    if (unlikely(dither_enabled)) {
+      v += next_dither();
+    }
+    v >>= FIR_SHIFT;
+
+    pipe_buf[pipe_s*pipe_interleave] = amplify(v, scaleFactor);
+    pipe_s++;
+  }
+}
+
+
 // ----------------------------------------------------------------------------
 // SID clocking with audio sampling - cycle based with audio resampling.
 // ----------------------------------------------------------------------------
@@ -1049,10 +3245,18 @@ int SID::clock_resample_fastmem(cycle_count& delta_t, short* buf, int n, int int
       delta_t_sample = delta_t;
     }
 
-    for (int i = 0; i < delta_t_sample; i++) {
-      clock();
-      sample[sample_index] = sample[sample_index + RINGSIZE] = clip(output());
-      ++sample_index &= RINGMASK;
+    // Clock in blocks, writing one sample per cycle directly into the ring
+    // buffer, and mirroring each block into the overflow copy.
+    for (cycle_count t = delta_t_sample; t > 0;) {
+      cycle_count nb = RINGSIZE - sample_index;
+      if (t < nb) {
+        nb = t;
+      }
+      clock_block(nb, sample + sample_index);
+      memcpy(sample + sample_index + RINGSIZE, sample + sample_index,
+             nb*sizeof(short));
+      sample_index = (sample_index + nb) & RINGMASK;
+      t -= nb;
     }
 
     if ((delta_t -= delta_t_sample) == 0) {
@@ -1062,21 +3266,148 @@ int SID::clock_resample_fastmem(cycle_count& delta_t, short* buf, int n, int int
 
     sample_offset = next_sample_offset & FIXP_MASK;
 
+    PROFILE_TICK(profile_t);
+
     int fir_offset = sample_offset*fir_RES >> FIXP_SHIFT;
-    short* fir_start = fir + fir_offset*fir_N;
+    const short* fir_start = fir + fir_offset*fir_N;
     short* sample_start = sample + sample_index - fir_N + RINGSIZE;
 
     // Convolution with filter impulse response.
-    int v = 0;
-    for (int j = 0; j < fir_N; j++) {
-      v += sample_start[j]*fir_start[j];
+    int v = fir_convolve(sample_start, fir_start, fir_N);
+
+    if (unlikely(dither_enabled)) {
+      v += next_dither();
+    }
+    v >>= FIR_SHIFT;
+
+    PROFILE_ACCUM(resample, profile_t);
+
+    buf[s*interleave] = amplify(v, scaleFactor);
+    if (unlikely(tap_buf[0] != 0)) {
+      write_voice_taps();
+    }
+    if (unlikely(ramp_remaining)) {
+      step_frequency_ramp();
+    }
+  }
+
+  PROFILE_COUNT(samples, s);
+
+  return s;
+}
+
+
+// ----------------------------------------------------------------------------
+// SID clocking with audio sampling - cycle based with two-stage audio
+// resampling.
+//
+// This implements the two-step resampling suggested above: stage 1
+// decimates the cycle stream by an integer factor to an intermediate
+// frequency near the Ganier optimum, through a short Kaiser windowed sinc
+// whose wide transition band only has to protect the passband from
+// aliasing. Stage 2 is the fractional resampler of clock_resample,
+// operating on the intermediate stream, where the shifted FIR tables are
+// an order of magnitude shorter than when built for raw cycles. The total
+// work is thus a fraction of that of SAMPLE_RESAMPLE, at the cost of the
+// slightly larger passband ripple of two cascaded filters.
+// ----------------------------------------------------------------------------
+int SID::clock_resample_twostage(cycle_count& delta_t, short* buf, int n, int interleave)
+{
+  int s;
+
+  for (s = 0; s < n; s++) {
+    cycle_count next_sample_offset = sample_offset + cycles_per_sample;
+    cycle_count delta_t_sample = next_sample_offset >> FIXP_SHIFT;
+
+    if (delta_t_sample > delta_t) {
+      delta_t_sample = delta_t;
+    }
+
+    // Clock in blocks, writing one sample per cycle directly into the
+    // stage 1 ring buffer, and mirroring each block into the overflow
+    // copy. Each completed frame of decimate cycles yields one
+    // intermediate sample, stored into the sample ring buffer.
+    for (cycle_count t = delta_t_sample; t > 0;) {
+      cycle_count nb = STAGE1_RINGSIZE - stage1_index;
+      if (t < nb) {
+        nb = t;
+      }
+      clock_block(nb, stage1_sample + stage1_index);
+      memcpy(stage1_sample + stage1_index + STAGE1_RINGSIZE,
+             stage1_sample + stage1_index, nb*sizeof(short));
+      stage1_index = (stage1_index + nb) & STAGE1_RINGMASK;
+      t -= nb;
+
+      decimate_index += nb;
+      PROFILE_TICK(profile_t1);
+      while (decimate_index >= decimate) {
+        decimate_index -= decimate;
+        // The frame ends decimate_index cycles before the write position.
+        int frame_end = (stage1_index - decimate_index) & STAGE1_RINGMASK;
+        int v = fir_convolve(stage1_sample + frame_end - stage1_N
+                             + STAGE1_RINGSIZE, stage1_fir, stage1_N);
+        short vi = clip(v >> FIR_SHIFT);
+        sample[sample_index] = vi;
+        sample[sample_index + RINGSIZE] = vi;
+        sample_index = (sample_index + 1) & RINGMASK;
+      }
+      PROFILE_ACCUM(resample, profile_t1);
+    }
+
+    if ((delta_t -= delta_t_sample) == 0) {
+      sample_offset -= delta_t_sample << FIXP_SHIFT;
+      break;
+    }
+
+    sample_offset = next_sample_offset & FIXP_MASK;
+
+    PROFILE_TICK(profile_t);
+
+    // The sample position relative to the intermediate sample grid, as a
+    // 16.16 fixed point fraction of an intermediate sample.
+    cycle_count inter_offset =
+      ((decimate_index << FIXP_SHIFT) + sample_offset)/decimate;
+
+    int fir_offset = inter_offset*fir_RES >> FIXP_SHIFT;
+    int fir_offset_rmd = inter_offset*fir_RES & FIXP_MASK;
+    const short* fir_start = fir + fir_offset*fir_N;
+    short* sample_start = sample + sample_index - fir_N - 1 + RINGSIZE;
+
+    // Convolution with filter impulse response.
+    int v1 = fir_convolve(sample_start, fir_start, fir_N);
+
+    // Use next FIR table, wrap around to first FIR table using
+    // next sample.
+    if (unlikely(++fir_offset == fir_RES)) {
+      fir_offset = 0;
+      ++sample_start;
     }
+    fir_start = fir + fir_offset*fir_N;
 
+    // Convolution with filter impulse response.
+    int v2 = fir_convolve(sample_start, fir_start, fir_N);
+
+    // Linear interpolation.
+    int v = v1 + int((unsigned(fir_offset_rmd)*unsigned(v2 - v1)) >> FIXP_SHIFT);
+
+    if (unlikely(dither_enabled)) {
+      v += next_dither();
+    }
     v >>= FIR_SHIFT;
 
+    PROFILE_ACCUM(resample, profile_t);
+
     buf[s*interleave] = amplify(v, scaleFactor);
+    if (unlikely(tap_buf[0] != 0)) {
+      write_voice_taps();
+    }
+    if (unlikely(ramp_remaining)) {
+      step_frequency_ramp();
+    }
   }
 
+  PROFILE_COUNT(samples, s);
+
   return s;
 }
 
@@ -32,35 +32,160 @@
 #include "extfilt.h"
 #include "pot.h"
 
+#include <stddef.h>
+
 namespace reSID
 {
 
+// Process-wide shared FIR table, see sid.cc.
+struct fir_table_entry;
+
+// Worker thread state for pipelined clocking, see sid.cc.
+class SIDPipeline;
+
 class SID
 {
 public:
   SID();
   ~SID();
 
+  enum {
+    // Resampling constants.
+    // The error in interpolated lookup is bounded by 1.234/L^2,
+    // while the error in non-interpolated lookup is bounded by
+    // 0.7854/L + 0.4113/L^2, see
+    // http://www-ccrma.stanford.edu/~jos/resample/Choice_Table_Size.html
+    // For a resolution of 16 bits this yields L >= 285 and L >= 51473,
+    // respectively.
+    FIR_N = 125,
+    FIR_RES = 285,
+    FIR_RES_FASTMEM = 51473,
+    FIR_SHIFT = 15,
+
+    RINGSIZE = 1 << 14,
+    RINGMASK = RINGSIZE - 1,
+
+    // Cycle ring buffer feeding stage 1 of the two-stage resampler.
+    STAGE1_RINGSIZE = 1 << 11,
+    STAGE1_RINGMASK = STAGE1_RINGSIZE - 1,
+
+    // Fixed point constants (16.16 bits).
+    FIXP_SHIFT = 16,
+    FIXP_MASK = 0xffff
+  };
+
   void set_chip_model(chip_model model);
   void set_voice_mask(reg4 mask);
   void enable_filter(bool enable);
+  // Select the computation based fast filter mode, trading some filter
+  // accuracy for a working set that fits in L1. See Filter::clock_fast.
+  void enable_fast_filter(bool enable);
+  // Split batched clocking between the calling thread (envelopes and
+  // oscillators) and a worker thread (filters and output), overlapping
+  // the two stages one chunk apart. Output is bit exact with the serial
+  // path. See sid.cc.
+  void enable_pipeline(bool enable);
   void adjust_filter_bias(double dac_bias);
   void enable_external_filter(bool enable);
+  // TPDF dither of the truncation of the resampling FIR accumulation
+  // to 16 bit output samples.
+  void enable_dither(bool enable);
   bool set_sampling_parameters(double clock_freq, sampling_method method,
   double sample_freq, double pass_freq = -1,
   double filter_scale = 0.97);
   void adjust_sampling_frequency(double sample_freq);
+  void ramp_sampling_frequency(double sample_freq, int slew_samples);
   void enable_raw_debug_output(bool enable);
 
+  // Per voice tapped outputs. When tap buffers are set, each output
+  // sample stored by clock(delta_t, buf, n, interleave) is accompanied
+  // by the current pre-filter output of each voice, scaled to 16 bits
+  // and stored to the corresponding tap buffer with the tap interleave.
+  // This shares all oscillator and envelope work with the main output;
+  // the taps are the voice outputs at the sample's nearest clock cycle,
+  // and are not put through the filters or the resampling FIR.
+  // The tap pointers advance as samples are stored, so the buffers must
+  // be set again before each clock call, and must hold as many samples
+  // as buf. Pass null pointers to disable.
+  void set_voice_taps(short* tap1, short* tap2, short* tap3,
+  int interleave = 1);
+
+  // Hot path instrumentation counters, maintained only when the library
+  // is compiled with RESID_PROFILE (--enable-profile). In normal builds
+  // the counters stay zero and the instrumentation compiles away
+  // completely. The tick counters are in TSC ticks on x86 and in
+  // nanoseconds elsewhere, and cover the batched clocking paths used by
+  // audio rendering; the single cycle interface is not instrumented.
+  struct Profile
+  {
+    unsigned long long envelope;  // envelope clocking
+    unsigned long long wave;      // oscillator clocking
+    unsigned long long filter;    // filter and external filter stages
+    unsigned long long resample;  // FIR convolutions in the sampling paths
+    unsigned long long cycles;    // emulated cycles
+    unsigned long long samples;   // output samples stored
+  };
+  Profile read_profile();
+  void reset_profile();
+
+  // Set directory for the persistent FIR table cache. The FIR tables
+  // computed in set_sampling_parameters are serialized to versioned
+  // binary files in this directory, and are memory mapped read-only on
+  // subsequent runs, sharing physical pages between processes with
+  // identical sampling parameters. An empty path (the default) disables
+  // the cache.
+  static void set_fir_cache_dir(const char* path);
+
+  // Memory allocation hooks for the sample ring buffers and the FIR
+  // tables, e.g. for placing them in a hugepage backed or NUMA local
+  // arena. The hooks apply process wide and must be set before the first
+  // set_sampling_parameters call allocates buffers; they must not be
+  // changed while any allocation is live, and must be thread safe if
+  // SIDs are configured from several threads. Pass null pointers to
+  // restore operator new[].
+  static void set_allocator(void* (*alloc)(size_t size, void* user),
+  void (*dealloc)(void* ptr, void* user),
+  void* user = 0);
+
+  // Upper bound on the bytes requested through the allocator hooks per
+  // SID instance, i.e. for the sample ring, the stage 1 ring and the
+  // stage 1 FIR of the resampling methods. The resampling FIR tables
+  // come on top of this; they are shared by all instances with identical
+  // sampling parameters, and their size is reported by fir_table_bytes
+  // once set_sampling_parameters has been called.
+  static size_t instance_buffer_bytes();
+  size_t fir_table_bytes() const;
+
   void clock();
   void clock(cycle_count delta_t);
   int clock(cycle_count& delta_t, short* buf, int n, int interleave = 1);
+  // Audio output as normalized floats in [-1, 1), rendered through the
+  // selected sampling method and converted in cache resident chunks.
+  int clock(cycle_count& delta_t, float* buf, int n, int interleave = 1);
   void reset();
 
+  // Cycles until the next internally scheduled state change. This allows
+  // a host scheduler to fast-forward the chip in large delta_t batches
+  // between register accesses. Returns the maximum cycle_count value if
+  // no event is scheduled.
+  cycle_count next_event();
+
   // Read/write registers.
   reg8 read(reg8 offset);
   void write(reg8 offset, reg8 value);
 
+  // Queue a register write to be applied after the specified number of
+  // cycles, counted from the current chip time. The queued events are
+  // consumed at their exact cycle positions by the buffer-filling
+  // clock(delta_t, buf, n, interleave) above, which removes the need to
+  // break rendering into small clock chunks around each register write.
+  // Events are applied in queue order; a write scheduled before the end
+  // of the queue is deferred until the previously queued event.
+  // Returns false if the queue is full, in which case the chip must be
+  // clocked to drain the queue first. Note that write() above takes
+  // effect immediately, bypassing any queued events.
+  bool queue_write(cycle_count delay, reg8 offset, reg8 value);
+
   // Read/write state.
   class State
   {
@@ -90,6 +215,44 @@ public:
     EnvelopeGenerator::State envelope_state[3];
     bool hold_zero[3];
     cycle_count envelope_pipeline[3];
+
+    // The remaining pipelined waveform and envelope state, making the
+    // snapshot complete: a write_state immediately followed by clocking
+    // continues bit-exactly from where read_state left off.
+    bool msb_rising[3];
+    reg12 waveform_output[3];
+    reg12 osc3[3];
+    reg12 tri_saw_pipeline[3];
+    reg12 noise_output[3];
+
+    cycle_count exponential_pipeline[3];
+    cycle_count state_pipeline[3];
+    reg8 new_exponential_counter_period[3];
+    EnvelopeGenerator::State envelope_next_state[3];
+    bool reset_rate_counter[3];
+    reg8 env3[3];
+
+    // Filter integrator and voice state, common to both filter
+    // implementations.
+    int Vhp, Vbp, Vbp_x, Vbp_vc, Vlp, Vlp_x, Vlp_vc;
+    int filter_ve, filter_v1, filter_v2, filter_v3;
+
+    // External filter state.
+    int extfilt_Vlp, extfilt_Vhp;
+
+    // Resampler state. The ring buffer contents are only valid for the
+    // resampling methods; for other methods they are zero.
+    cycle_count sample_offset;
+    int sample_index;
+    short sample_prev, sample_now;
+    short sample_prev2, sample_prev3;
+    short sample[RINGSIZE*2];
+
+    // Stage 1 state of the two-stage resampler; only valid for
+    // SAMPLE_RESAMPLE_TWOSTAGE, zero for other methods.
+    int decimate_index;
+    int stage1_index;
+    short stage1_sample[STAGE1_RINGSIZE*2];
   };
 
   State read_state();
@@ -105,10 +268,35 @@ public:
 
  protected:
   static double I0(double x);
+  static fir_table_entry* acquire_fir_table(int fir_N, int fir_RES,
+  double beta, double f_cycles_per_sample, double filter_scale);
+  static void release_fir_table(fir_table_entry* entry);
+  void release_fir();
+  void clock_block(cycle_count delta_t, short* buf);
+  // Stage 1 of clock_block: envelopes and oscillators, staging the per
+  // voice sample streams.
+  void clock_voice_block(cycle_count n, bool coupled,
+  int* v1, int* v2, int* v3);
+  // Stage 2 of clock_block: filter, external filter and output.
+  void clock_filter_dispatch(cycle_count n, const int* v1, const int* v2,
+  const int* v3, short* buf);
+  // Filter stage loop of clock_block, specialized on the configuration
+  // so that the per cycle loop carries no branches for disabled stages.
+  template<bool filter_enabled, bool extfilt_enabled>
+  void clock_filter_block(cycle_count n, const int* v1, const int* v2,
+  const int* v3, short* buf);
+  int clock_sample(cycle_count& delta_t, short* buf, int n, int interleave);
   int clock_fast(cycle_count& delta_t, short* buf, int n, int interleave);
   int clock_interpolate(cycle_count& delta_t, short* buf, int n, int interleave);
+  int clock_interpolate_cubic(cycle_count& delta_t, short* buf, int n, int interleave);
   int clock_resample(cycle_count& delta_t, short* buf, int n, int interleave);
+  int clock_resample_pipelined(cycle_count& delta_t, short* buf, int n, int interleave);
+  // Stage 2 of a pipelined chunk, run on the worker thread.
+  void pipeline_filter_chunk(cycle_count n, const int* v1, const int* v2,
+  const int* v3);
   int clock_resample_fastmem(cycle_count& delta_t, short* buf, int n, int interleave);
+  int clock_resample_twostage(cycle_count& delta_t, short* buf, int n, int interleave);
+  void write_voice_taps();
   void write();
 
   chip_model sid_model;
@@ -128,38 +316,49 @@ public:
   cycle_count write_pipeline;
   reg8 write_address;
 
+  // Timestamped write queue, applied at exact cycle positions by
+  // clock(delta_t, buf, n, interleave). Event offsets are stored relative
+  // to the previous queued event, so only the head event is aged as the
+  // chip is clocked.
+  struct write_event
+  {
+    cycle_count offset;
+    reg8 address;
+    reg8 value;
+  };
+  enum {
+    // Must be a power of two.
+    WRITE_QUEUE_SIZE = 1024,
+    WRITE_QUEUE_MASK = WRITE_QUEUE_SIZE - 1
+  };
+  write_event write_queue[WRITE_QUEUE_SIZE];
+  int write_queue_head;
+  int write_queue_tail;
+  // Delay from the current chip time to the last queued event.
+  cycle_count write_queue_end;
+
   double clock_frequency;
 
   // Used to amplify the output by scaleFactor/2 to get an adequate playback volume
   int scaleFactor;
 
-  enum {
-    // Resampling constants.
-    // The error in interpolated lookup is bounded by 1.234/L^2,
-    // while the error in non-interpolated lookup is bounded by
-    // 0.7854/L + 0.4113/L^2, see
-    // http://www-ccrma.stanford.edu/~jos/resample/Choice_Table_Size.html
-    // For a resolution of 16 bits this yields L >= 285 and L >= 51473,
-    // respectively.
-    FIR_N = 125,
-    FIR_RES = 285,
-    FIR_RES_FASTMEM = 51473,
-    FIR_SHIFT = 15,
-
-    RINGSIZE = 1 << 14,
-    RINGMASK = RINGSIZE - 1,
-
-    // Fixed point constants (16.16 bits).
-    FIXP_SHIFT = 16,
-    FIXP_MASK = 0xffff
-  };
-
   // Sampling variables.
   sampling_method sampling;
   cycle_count cycles_per_sample;
+  // Sampling frequency ramp; see ramp_sampling_frequency.
+  void step_frequency_ramp();
+  cycle_count ramp_target;
+  int ramp_remaining;
+  // Output dither; see enable_dither.
+  int next_dither();
+  bool dither_enabled;
+  unsigned int dither_state;
   cycle_count sample_offset;
   int sample_index;
+  // Cycle output history; SAMPLE_INTERPOLATE uses the last two entries,
+  // SAMPLE_INTERPOLATE_CUBIC all four.
   short sample_prev, sample_now;
+  short sample_prev2, sample_prev3;
   int fir_N;
   int fir_RES;
   double fir_beta;
@@ -167,12 +366,136 @@ public:
   double fir_filter_scale;
 
   // Ring buffer with overflow for contiguous storage of RINGSIZE samples.
+  // For SAMPLE_RESAMPLE_TWOSTAGE this holds the intermediate samples
+  // produced by stage 1 instead of raw cycles.
   short* sample;
 
+  // Stage 1 of the two-stage resampler: integer decimation of the cycle
+  // stream by a factor of decimate, through a short Kaiser windowed sinc
+  // of stage1_N taps. The cycle ring buffer has the same overflow
+  // mirroring as the sample ring buffer above. decimate_index counts
+  // cycles into the current decimation frame.
+  int decimate;
+  int decimate_index;
+  int stage1_N;
+  short* stage1_fir;
+  short* stage1_sample;
+  int stage1_index;
+
   // FIR_RES filter tables (FIR_N*FIR_RES).
-  short* fir;
+  // The table itself is immutable and owned by a process-wide refcounted
+  // cache; SID instances with identical sampling parameters share one
+  // physical copy. fir points at the table data of fir_handle.
+  const short* fir;
+  fir_table_entry* fir_handle;
+
+  // Per voice tap output pointers, see set_voice_taps. Advanced as
+  // samples are stored; null when tapping is disabled.
+  short* tap_buf[3];
+  int tap_interleave;
+
+  // Instrumentation counters, see read_profile.
+  Profile profile_counters;
+
+  // Pipelined clocking worker; null when disabled. See enable_pipeline.
+  SIDPipeline* pipeline;
+  // Stage 2 bookkeeping of the pipelined resampling path, owned by the
+  // worker thread between submit and drain; see clock_resample_pipelined.
+  cycle_count pipe_avail;
+  cycle_count pipe_total;
+  cycle_count pipe_consumed;
+  short* pipe_buf;
+  int pipe_n;
+  int pipe_s;
+  int pipe_interleave;
 
   bool raw_debug_output; // FIXME: should be private?
+
+friend class SIDPipeline;
+};
+
+
+// ----------------------------------------------------------------------------
+// Checkpoint index for constant time seeking.
+//
+// Playback position in a tune is normally only reachable by re-emulating
+// from cycle zero, since the chip state at an arbitrary position depends
+// on the full register write history. The index records complete State
+// snapshots at a fixed cycle interval during playback, together with the
+// register write stream, and can then seek to any recorded position by
+// restoring the nearest checkpoint and re-emulating at most one interval
+// of cycles, replaying the logged writes at their exact positions.
+//
+// Recording: route all register writes through write() below instead of
+// SID::write, and report each batch of clocked cycles with advance().
+// Writes queued with SID::queue_write are not observed and must not be
+// used while recording. Positions are absolute cycle counts from the
+// start of recording; they are kept in long long since cycle_count
+// overflows after ~36 minutes of C64 time.
+//
+// Seeking: seek() restores the chip bit-exactly to any position up to
+// position(), including the resampler state, by rolling the chip forward
+// with the configured sampling method. Recording may simply continue
+// after a seek to the current end of the index.
+//
+// The serialized form is versioned but host and build specific, like the
+// FIR table cache files; deserialize rejects mismatches.
+// ----------------------------------------------------------------------------
+class SIDCheckpointIndex
+{
+public:
+  SIDCheckpointIndex(cycle_count interval = 10000000);
+  ~SIDCheckpointIndex();
+
+  // Recording side. The first call records the initial checkpoint.
+  void write(SID& sid, reg8 offset, reg8 value);
+  void advance(SID& sid, cycle_count delta_t);
+
+  // Cycles recorded so far.
+  long long position() const;
+  int checkpoints() const;
+
+  // Restore the chip to the given position. Returns the number of cycles
+  // re-emulated (bounded by the checkpoint interval plus one advance
+  // batch), or -1 if the position is outside the recorded range.
+  long long seek(SID& sid, long long target);
+
+  // Serialization to a caller provided buffer of serialize_bytes() bytes.
+  size_t serialize_bytes() const;
+  void serialize(char* buf) const;
+  // Returns a new index, or null if the buffer does not hold an index
+  // serialized by this build.
+  static SIDCheckpointIndex* deserialize(const char* buf, size_t size);
+
+protected:
+  struct Checkpoint
+  {
+    long long cycle;
+    SID::State state;
+  };
+
+  struct WriteRecord
+  {
+    long long cycle;
+    reg8 offset;
+    reg8 value;
+  };
+
+  void record_checkpoint(SID& sid);
+  static void roll_forward(SID& sid, cycle_count delta_t);
+
+  cycle_count checkpoint_interval;
+  long long cycle;
+  long long next_checkpoint;
+
+  // Growable arrays; the snapshots are large and thus held by pointer.
+  Checkpoint** checkpoint_list;
+  int n_checkpoints;
+  int checkpoint_capacity;
+
+  WriteRecord* write_log;
+  int n_writes;
+  int write_capacity;
 };
 
 
@@ -20,7 +20,6 @@
 #define RESID_WAVE_CC
 
 #include "wave.h"
-#include "dac.h"
 
 namespace reSID
 {
@@ -45,8 +44,9 @@ const cycle_count FLOATING_OUTPUT_TTL_BIT_6581   =    1500;
 const cycle_count FLOATING_OUTPUT_TTL_START_8580 = 4400000; // ~5s
 const cycle_count FLOATING_OUTPUT_TTL_BIT_8580   =   50000;
 
-// Waveform lookup tables.
-unsigned short WaveformGenerator::model_wave[2][8][1 << 12] = {
+// Sampled combined waveform data, interleaved into model_wave by
+// class_init_tables below.
+static const unsigned short wave_samples[2][8][1 << 12] = {
   {
     {0},
     {0},
@@ -69,46 +69,65 @@ unsigned short WaveformGenerator::model_wave[2][8][1 << 12] = {
   }
 };
 
+// Waveform lookup tables, interleaved as [accumulator index][waveform] so
+// that morphing between waveform selections stays within the same cache
+// lines instead of thrashing across eight separate 8KB arrays.
+unsigned short WaveformGenerator::model_wave[2][1 << 12][8];
 
-// DAC lookup tables.
-unsigned short WaveformGenerator::model_dac[2][1 << 12] = {
-  {0},
-  {0},
+
+// DAC lookup tables for 12-bit DACs, computed at compile time.
+// MOS 6581: 2R/R ~ 2.20, missing termination resistor.
+// MOS 8580: 2R/R ~ 2.00, correct termination.
+const dac_table<12> WaveformGenerator::model_dac[2] = {
+  dac_table<12>(2.20, false),
+  dac_table<12>(2.00, true)
 };
 
 
 // ----------------------------------------------------------------------------
-// Constructor.
+// One-time initialization of the static waveform tables.
 // ----------------------------------------------------------------------------
-WaveformGenerator::WaveformGenerator()
+bool WaveformGenerator::class_init_tables()
 {
-  static bool class_init;
-
-  if (!class_init) {
-    // Calculate tables for normal waveforms.
-    accumulator = 0;
-    for (int i = 0; i < (1 << 12); i++) {
-      reg24 msb = accumulator & 0x800000;
+  // Calculate normal waveforms, and interleave the sampled combined
+  // waveforms into the same rows.
+  reg24 accumulator = 0;
+  for (int i = 0; i < (1 << 12); i++) {
+    reg24 msb = accumulator & 0x800000;
+
+    // Noise mask, triangle, sawtooth, pulse mask.
+    // The triangle calculation is made branch-free, just for the hell of it.
+    reg12 tri = ((accumulator ^ -!!msb) >> 11) & 0xffe;
+    reg12 saw = accumulator >> 12;
+
+    for (int m = 0; m < 2; m++) {
+      model_wave[m][i][0] = 0xfff;
+      model_wave[m][i][1] = tri;
+      model_wave[m][i][2] = saw;
+      model_wave[m][i][3] = wave_samples[m][3][i];
+      model_wave[m][i][4] = 0xfff;
+      model_wave[m][i][5] = wave_samples[m][5][i];
+      model_wave[m][i][6] = wave_samples[m][6][i];
+      model_wave[m][i][7] = wave_samples[m][7][i];
+    }
 
-      // Noise mask, triangle, sawtooth, pulse mask.
-      // The triangle calculation is made branch-free, just for the hell of it.
-      model_wave[0][0][i] = model_wave[1][0][i] = 0xfff;
-      model_wave[0][1][i] = model_wave[1][1][i] = ((accumulator ^ -!!msb) >> 11) & 0xffe;
-      model_wave[0][2][i] = model_wave[1][2][i] = accumulator >> 12;
-      model_wave[0][4][i] = model_wave[1][4][i] = 0xfff;
+    accumulator += 0x1000;
+  }
 
-      accumulator += 0x1000;
-    }
+  return true;
+}
 
-    // Build DAC lookup tables for 12-bit DACs.
-    // MOS 6581: 2R/R ~ 2.20, missing termination resistor.
-    build_dac_table(model_dac[0], 12, 2.20, false);
-    // MOS 8580: 2R/R ~ 2.00, correct termination.
-    build_dac_table(model_dac[1], 12, 2.00, true);
+// The tables are built before main, while the process is still single
+// threaded; constructing SID instances from worker threads is then free
+// of races and hidden constructor guard variables.
+bool WaveformGenerator::class_init = WaveformGenerator::class_init_tables();
 
-    class_init = true;
-  }
 
+// ----------------------------------------------------------------------------
+// Constructor.
+// ----------------------------------------------------------------------------
+WaveformGenerator::WaveformGenerator()
+{
   sync_source = this;
 
   sid_model = MOS6581;
@@ -138,7 +157,7 @@ void WaveformGenerator::set_sync_source(WaveformGenerator* source)
 void WaveformGenerator::set_chip_model(chip_model model)
 {
   sid_model = model;
-  wave = model_wave[model][waveform & 0x7];
+  wave = model_wave[model][0] + (waveform & 0x7);
 }
 
 
@@ -208,7 +227,7 @@ void WaveformGenerator::writeCONTROL_REG(reg8 control)
   sync = control & 0x02;
 
   // Set up waveform table.
-  wave = model_wave[sid_model][waveform & 0x7];
+  wave = model_wave[sid_model][0] + (waveform & 0x7);
 
   // Substitution of accumulator MSB when sawtooth = 0, ring_mod = 1.
   ring_msb_mask = ((~control >> 5) & (control >> 2) & 0x1) << 23;
@@ -295,6 +314,35 @@ reg8 WaveformGenerator::readOSC()
   return osc3 >> 4;
 }
 
+// ----------------------------------------------------------------------------
+// Number of cycles until the next internally scheduled state change,
+// covering the timed countdowns of the waveform generator: the noise
+// shift register pipeline and reset, and the floating waveform output
+// fade. Continuous accumulator state is not included; it is stepped
+// exactly in closed form by clock(delta_t). See SID::next_event().
+// ----------------------------------------------------------------------------
+cycle_count WaveformGenerator::next_event()
+{
+  cycle_count t_min = 0x7fffffff;
+
+  if (unlikely(test)) {
+    if (shift_register_reset) {
+      t_min = shift_register_reset;
+    }
+  }
+  else if (unlikely(shift_pipeline)) {
+    t_min = shift_pipeline;
+  }
+
+  if (unlikely(!waveform) && floating_output_ttl
+      && floating_output_ttl < t_min)
+  {
+    t_min = floating_output_ttl;
+  }
+
+  return t_min;
+}
+
 // ----------------------------------------------------------------------------
 // SID reset.
 // ----------------------------------------------------------------------------
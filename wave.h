@@ -21,6 +21,7 @@
 #define RESID_WAVE_H
 
 #include "resid-config.h"
+#include "dac.h"
 
 namespace reSID
 {
@@ -53,6 +54,9 @@ public:
   void writeCONTROL_REG(reg8);
   reg8 readOSC();
 
+  // Cycles until the next internally scheduled state change.
+  cycle_count next_event();
+
   // 12-bit waveform output.
   short output();
 
@@ -62,6 +66,7 @@ public:
 
 protected:
   void clock_shift_register();
+  void clock_shift_register(cycle_count shifts);
   void write_shift_register();
   void set_noise_output();
   void wave_bitfade();
@@ -116,11 +121,19 @@ protected:
 
   chip_model sid_model;
 
-  // Sample data for waveforms, not including noise.
+  // Sample data for waveforms, not including noise. The table is
+  // interleaved as [accumulator index][waveform], so that tunes morphing
+  // between combined waveforms stay within the same cache lines; wave
+  // points at the selected waveform column and is indexed by ix << 3.
   unsigned short* wave;
-  static unsigned short model_wave[2][8][1 << 12];
-  // DAC lookup tables.
-  static unsigned short model_dac[2][1 << 12];
+  static unsigned short model_wave[2][1 << 12][8];
+  // DAC lookup tables, computed at compile time into read-only memory.
+  static const dac_table<12> model_dac[2];
+
+  // One-time initialization of the static waveform tables above, run
+  // before main by the class_init initializer; see wave.cc.
+  static bool class_init_tables();
+  static bool class_init;
 
 friend class Voice;
 friend class SID;
@@ -198,6 +211,17 @@ void WaveformGenerator::clock(cycle_count delta_t)
     reg24 delta_accumulator = delta_t*freq;
     reg24 accumulator_next = (accumulator + delta_accumulator) & 0xffffff;
     reg24 accumulator_bits_set = ~accumulator & accumulator_next;
+
+    // Shift noise register once for each time accumulator bit 19 is set high.
+    // Bit 19 is set high each time 2^20 (0x100000) is added to the accumulator,
+    // i.e. once for each point congruent to 2^19 modulo 2^20 passed by the
+    // accumulator. The number of such points is computed in closed form from
+    // the full and partial shift periods covered, and the shift register is
+    // advanced in bulk below instead of once per shift.
+    cycle_count shifts = (delta_accumulator >> 20)
+      + ((((accumulator + 0x080000) & 0x0fffff)
+          + (delta_accumulator & 0x0fffff)) >> 20);
+
     accumulator = accumulator_next;
 
     // Check whether the MSB is set high. This is used for synchronization.
@@ -206,36 +230,10 @@ void WaveformGenerator::clock(cycle_count delta_t)
     // NB! Any pipelined shift register clocking from single cycle clocking
     // will be lost. It is not worth the trouble to flush the pipeline here.
 
-    // Shift noise register once for each time accumulator bit 19 is set high.
-    // Bit 19 is set high each time 2^20 (0x100000) is added to the accumulator.
-    reg24 shift_period = 0x100000;
-
-    while (delta_accumulator) {
-      if (likely(delta_accumulator < shift_period)) {
-        shift_period = delta_accumulator;
-        // Determine whether bit 19 is set on the last period.
-        // NB! Requires two's complement integer.
-        if (likely(shift_period <= 0x080000)) {
-          // Check for flip from 0 to 1.
-          if (((accumulator - shift_period) & 0x080000) || !(accumulator & 0x080000))
-            {
-              break;
-            }
-        }
-        else {
-          // Check for flip from 0 (to 1 or via 1 to 0) or from 1 via 0 to 1.
-          if (((accumulator - shift_period) & 0x080000) && !(accumulator & 0x080000))
-            {
-              break;
-            }
-        }
-      }
-
+    if (shifts) {
       // Shift the noise/random register.
       // NB! The two-cycle pipeline delay is only modeled for 1 cycle clocking.
-      clock_shift_register();
-
-      delta_accumulator -= shift_period;
+      clock_shift_register(shifts);
     }
 
     // Calculate pulse high/low.
@@ -328,6 +326,33 @@ RESID_INLINE void WaveformGenerator::clock_shift_register()
   set_noise_output();
 }
 
+// Advance the shift register several steps in one go. An LFSR advanced N
+// steps is a linear function of its state, and since bit0 = bit22 ^ bit17
+// only taps bits which survive up to 18 single steps, the bits fed back
+// during steps i = 0, ..., N-1 for N <= 18 are bits 22 - i and 17 - i of
+// the current state. The N new low bits are thus a shifted XOR of the
+// register with itself, and larger step counts are taken 18 steps at a
+// time. The noise output is only updated once, for the final state.
+RESID_INLINE void WaveformGenerator::clock_shift_register(cycle_count shifts)
+{
+  while (shifts >= 18) {
+    shift_register =
+      ((shift_register << 18)
+       | ((shift_register ^ (shift_register >> 5)) & 0x3ffff)) & 0x7fffff;
+    shifts -= 18;
+  }
+  if (shifts) {
+    reg24 mask = (1 << shifts) - 1;
+    shift_register =
+      ((shift_register << shifts)
+       | (((shift_register >> (23 - shifts))
+           ^ (shift_register >> (18 - shifts))) & mask)) & 0x7fffff;
+  }
+
+  // New noise waveform output.
+  set_noise_output();
+}
+
 RESID_INLINE void WaveformGenerator::write_shift_register()
 {
   // Write changes to the shift register output caused by combined waveforms
@@ -464,7 +489,7 @@ void WaveformGenerator::set_waveform_output()
     // calculation of the output value.
     int ix = (accumulator ^ (~sync_source->accumulator & ring_msb_mask)) >> 12;
 
-    waveform_output = wave[ix] & (no_pulse | pulse_output) & no_noise_or_noise_output;
+    waveform_output = wave[ix << 3] & (no_pulse | pulse_output) & no_noise_or_noise_output;
 
     if (unlikely((waveform & 0xc) == 0xc))
     {
@@ -478,7 +503,7 @@ void WaveformGenerator::set_waveform_output()
     if ((waveform & 3) && (sid_model == MOS8580))
     {
         osc3 = tri_saw_pipeline & (no_pulse | pulse_output) & no_noise_or_noise_output;
-        tri_saw_pipeline = wave[ix];
+        tri_saw_pipeline = wave[ix << 3];
     }
     else
     {
@@ -527,7 +552,7 @@ void WaveformGenerator::set_waveform_output(cycle_count delta_t)
     // calculation of the output value.
     int ix = (accumulator ^ (~sync_source->accumulator & ring_msb_mask)) >> 12;
     waveform_output =
-      wave[ix] & (no_pulse | pulse_output) & no_noise_or_noise_output;
+      wave[ix << 3] & (no_pulse | pulse_output) & no_noise_or_noise_output;
     // Triangle/Sawtooth output delay for the 8580 is not modeled
     osc3 = waveform_output;
 